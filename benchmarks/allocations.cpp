@@ -0,0 +1,30 @@
+#include "benchmark.hpp"
+#include "template.hpp"
+
+// Heap allocations per render of a template that runs most of each
+// product through a chain of filters.
+BENCHMARK_CASE(FilterAllocations) {
+    Liquid::Template tmpl;
+    tmpl.parse(
+        "{% for product in products %}"
+        "{{ product.title | upcase | append: ' - ' | append: product.handle | truncate: 30 }}"
+        "{{ product.price | times: 1.2 | round: 2 | prepend: '$' }}"
+        "{{ product.description | downcase | replace: 'product', 'item' | size }}"
+        "{{ product.tags | join: ', ' | capitalize }}"
+        "{% assign label = product.title | split: ' ' | first %}{{ label | default: 'none' }}"
+        "{% endfor %}"
+    );
+    const int products = 1000;
+    const Liquid::Data data = Benchmark::catalogData(products);
+    (void)tmpl.render(data);
+
+    const size_t before = Benchmark::allocations().count;
+    (void)tmpl.render(data);
+    const size_t count = Benchmark::allocations().count - before;
+
+    const double seconds = Benchmark::measure([&] {
+        (void)tmpl.render(data);
+    });
+    Benchmark::report("allocations per product", static_cast<double>(count) / products, "");
+    Benchmark::report("renders/s", 1 / seconds, "");
+}
@@ -0,0 +1,22 @@
+#include "benchmark.hpp"
+#include "template.hpp"
+
+BENCHMARK_CASE(RenderBatch) {
+    Liquid::Template tmpl;
+    tmpl.parse(Benchmark::catalogTemplate());
+    const std::vector<Liquid::Data> items(2000, Benchmark::catalogData(10));
+
+    const double serialSeconds = Benchmark::measure([&] {
+        for (const auto& item : items) {
+            Liquid::Data data = item;
+            (void)tmpl.render(data);
+        }
+    });
+    Benchmark::report("serial loop: renders/s", items.size() / serialSeconds, "");
+
+    Liquid::ThreadPool pool;
+    const double batchSeconds = Benchmark::measure([&] {
+        (void)tmpl.renderBatch(items, pool);
+    });
+    Benchmark::report("renderBatch (" + std::to_string(pool.concurrency()) + " threads): renders/s", items.size() / batchSeconds, "");
+}
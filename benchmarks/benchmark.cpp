@@ -0,0 +1,166 @@
+#include "benchmark.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+namespace {
+    // Each block starts with its size, padded to keep the alignment malloc
+    // gives.
+    const size_t kHeaderSize = 16;
+
+    std::atomic<size_t> allocationCount{0};
+    std::atomic<size_t> liveBytes{0};
+
+    void* allocate(size_t size) noexcept {
+        char* block = static_cast<char*>(std::malloc(size + kHeaderSize));
+        if (!block) {
+            return nullptr;
+        }
+        *reinterpret_cast<size_t*>(block) = size;
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        liveBytes.fetch_add(size, std::memory_order_relaxed);
+        return block + kHeaderSize;
+    }
+
+    void release(void* ptr) noexcept {
+        if (!ptr) {
+            return;
+        }
+        char* block = static_cast<char*>(ptr) - kHeaderSize;
+        liveBytes.fetch_sub(*reinterpret_cast<size_t*>(block), std::memory_order_relaxed);
+        std::free(block);
+    }
+
+    void* allocateOrThrow(size_t size) {
+        void* ptr = allocate(size);
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+}
+
+void* operator new(size_t size) {
+    return allocateOrThrow(size);
+}
+
+void* operator new[](size_t size) {
+    return allocateOrThrow(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    release(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    release(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    release(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    release(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    release(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    release(ptr);
+}
+
+Benchmark::Allocations Benchmark::allocations()
+{
+    return Allocations{allocationCount.load(), liveBytes.load()};
+}
+
+std::vector<Benchmark::Case>& Benchmark::cases()
+{
+    static std::vector<Case> cases;
+    return cases;
+}
+
+void Benchmark::report(const std::string& label, double value, const std::string& unit)
+{
+    std::cout << "  " << std::left << std::setw(48) << label << std::right << std::setw(14) << std::fixed << std::setprecision(2) << value << " " << unit << std::endl;
+}
+
+Liquid::String Benchmark::catalogTemplate()
+{
+    return
+        "<!DOCTYPE html>\n"
+        "<html>\n"
+        "<head>\n"
+        "  <meta charset=\"utf-8\">\n"
+        "  <title>{{ shop.name }}</title>\n"
+        "  <link rel=\"stylesheet\" href=\"/assets/theme.css\">\n"
+        "</head>\n"
+        "<body class=\"catalog\">\n"
+        "  <header class=\"site-header\"><h1>{{ shop.name | upcase }}</h1></header>\n"
+        "  <main class=\"product-grid\">\n"
+        "  {% for product in products %}\n"
+        "    <article class=\"product-card\" id=\"product-{{ product.id }}\">\n"
+        "      <a class=\"product-card__link\" href=\"/products/{{ product.handle }}\">\n"
+        "        <h2 class=\"product-card__title\">{{ product.title }}</h2>\n"
+        "      </a>\n"
+        "      {% comment %}Price and availability{% endcomment %}\n"
+        "      {% if product.available %}\n"
+        "        <span class=\"product-card__price\">{{ product.price }}</span>\n"
+        "        <button class=\"button button--primary\" type=\"submit\">Add to cart</button>\n"
+        "      {% else %}\n"
+        "        <span class=\"product-card__sold-out\">Sold out</span>\n"
+        "      {% endif %}\n"
+        "      <p class=\"product-card__description\">{{ product.description }}</p>\n"
+        "      <ul class=\"product-card__tags\">\n"
+        "      {% for tag in product.tags %}\n"
+        "        <li class=\"product-card__tag\">{{ tag }}</li>\n"
+        "      {% endfor %}\n"
+        "      </ul>\n"
+        "    </article>\n"
+        "  {% endfor %}\n"
+        "  </main>\n"
+        "  <footer class=\"site-footer\">\n"
+        "    <p>&copy; {{ shop.name }}. All rights reserved.</p>\n"
+        "  </footer>\n"
+        "</body>\n"
+        "</html>\n";
+}
+
+Liquid::Data Benchmark::catalogData(int products)
+{
+    Liquid::Data shop{Liquid::Data::Type::Hash};
+    shop.insert("name", "Example Store");
+    Liquid::Data list{Liquid::Data::Type::Array};
+    for (int i = 0; i < products; ++i) {
+        Liquid::Data product{Liquid::Data::Type::Hash};
+        const std::string index = std::to_string(i);
+        product.insert("id", i);
+        product.insert("handle", Liquid::String("product-" + index));
+        product.insert("title", Liquid::String("Product " + index));
+        product.insert("available", i % 4 != 0);
+        product.insert("price", 9.99 + i % 50);
+        product.insert("description", Liquid::String("A short description of product " + index + "."));
+        Liquid::Data tags{Liquid::Data::Type::Array};
+        tags.push_back("new");
+        tags.push_back("sale");
+        product.insert("tags", tags);
+        list.push_back(product);
+    }
+    Liquid::Data data{Liquid::Data::Type::Hash};
+    data.insert("shop", shop);
+    data.insert("products", list);
+    return data;
+}
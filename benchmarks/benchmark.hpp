@@ -0,0 +1,65 @@
+#ifndef LIQUID_BENCHMARK_HPP
+#define LIQUID_BENCHMARK_HPP
+
+#include "data.hpp"
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Benchmark {
+
+    using Function = std::function<void()>;
+
+    struct Case {
+        std::string name;
+        Function function;
+    };
+
+    std::vector<Case>& cases();
+
+    class Registrar {
+    public:
+        Registrar(const char* name, const Function& function) {
+            cases().push_back(Case{name, function});
+        }
+    };
+
+    // Calls function repeatedly for at least minSeconds and returns the
+    // average number of seconds per call.
+    template <typename F>
+    double measure(F function, double minSeconds = 0.5) {
+        using Clock = std::chrono::steady_clock;
+        size_t iterations = 0;
+        const auto start = Clock::now();
+        std::chrono::duration<double> elapsed{0};
+        do {
+            function();
+            ++iterations;
+            elapsed = Clock::now() - start;
+        } while (elapsed.count() < minSeconds);
+        return elapsed.count() / iterations;
+    }
+
+    void report(const std::string& label, double value, const std::string& unit);
+
+    // Heap use of the whole program, counted by the global operator new and
+    // operator delete in benchmark.cpp.
+    struct Allocations {
+        size_t count;
+        size_t liveBytes;
+    };
+    Allocations allocations();
+
+    // A product listing page: mostly static markup with a few values per product.
+    Liquid::String catalogTemplate();
+    Liquid::Data catalogData(int products);
+
+}
+
+#define BENCHMARK_CASE(name) \
+    static void BENCHMARK_##name(); \
+    static const Benchmark::Registrar BENCHMARK_REGISTRAR_##name(#name, BENCHMARK_##name); \
+    static void BENCHMARK_##name()
+
+#endif
@@ -0,0 +1,49 @@
+#include "benchmark.hpp"
+#include "template.hpp"
+#include <memory>
+
+// Products loaded from one document held in memory, as a JSON or protobuf
+// loader would: each description either copied into the data or borrowed
+// from the document.
+BENCHMARK_CASE(BorrowedStrings) {
+    const int products = 20000;
+    const Liquid::String::size_type descriptionSize = 400;
+    std::string text;
+    for (int i = 0; i < products; ++i) {
+        std::string description = "Description of product " + std::to_string(i) + ": ";
+        description.resize(descriptionSize, 'x');
+        text += description;
+    }
+    const auto document = std::make_shared<const Liquid::String>(text);
+
+    Liquid::Template tmpl;
+    tmpl.parse("{% for product in products %}{{ product.description | truncate: 20 }}{{ product.description }}{% endfor %}");
+
+    for (const bool borrow : {false, true}) {
+        const std::string label = borrow ? "borrowed" : "copied";
+        const size_t start = Benchmark::allocations().liveBytes;
+        Liquid::Data data;
+        const double buildSeconds = Benchmark::measure([&] {
+            Liquid::Data list{Liquid::Data::Type::Array};
+            list.array().reserve(products);
+            for (int i = 0; i < products; ++i) {
+                const Liquid::String::value_type* description = document->data() + i * descriptionSize;
+                Liquid::Data product{Liquid::Data::Type::Hash};
+                if (borrow) {
+                    product.insert("description", Liquid::Data(description, descriptionSize, document));
+                } else {
+                    product.insert("description", Liquid::String(description, descriptionSize));
+                }
+                list.push_back(std::move(product));
+            }
+            data = Liquid::Data(Liquid::Data::Hash{{"products", std::move(list)}});
+        }, 0);
+        const size_t bytes = Benchmark::allocations().liveBytes - start;
+        const double renderSeconds = Benchmark::measure([&] {
+            (void)tmpl.render(data);
+        });
+        Benchmark::report(label + ": load", buildSeconds * 1000, "ms");
+        Benchmark::report(label + ": data size", static_cast<double>(bytes) / (1024 * 1024), "MB");
+        Benchmark::report(label + ": renders/s", 1 / renderSeconds, "");
+    }
+}
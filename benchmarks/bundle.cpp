@@ -0,0 +1,53 @@
+#include "benchmark.hpp"
+#include "bundle.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Compiles a theme-sized directory of templates with one thread and with
+// a thread per core.
+BENCHMARK_CASE(Bundle) {
+    const int kTemplates = 400;
+    const std::string directory = "cppliquid-bench-bundle";
+#ifdef _WIN32
+    (void)_mkdir(directory.c_str());
+#else
+    (void)::mkdir(directory.c_str(), 0755);
+#endif
+    const std::string source = Benchmark::catalogTemplate().toStdString();
+    std::vector<std::string> paths;
+    for (int i = 0; i < kTemplates; ++i) {
+        paths.push_back(directory + "/template" + std::to_string(i) + ".liquid");
+        std::ofstream file(paths.back(), std::ios::out | std::ios::binary | std::ios::trunc);
+        file << source << "{{ section" << i << " }}";
+    }
+
+    Liquid::ThreadPool serialPool(1);
+    Liquid::ThreadPool pool;
+    double serialSeconds = 0;
+    double parallelSeconds = 0;
+    double slowestFile = 0;
+    (void)Benchmark::measure([&] {
+        serialSeconds = Liquid::TemplateBundle::compileDirectory(directory, serialPool).wallSeconds();
+    });
+    (void)Benchmark::measure([&] {
+        const Liquid::TemplateBundle bundle = Liquid::TemplateBundle::compileDirectory(directory, pool);
+        parallelSeconds = bundle.wallSeconds();
+        for (const auto& file : bundle.files()) {
+            slowestFile = std::max(slowestFile, file.parseSeconds);
+        }
+    });
+    Benchmark::report("1 thread: wall", serialSeconds * 1000, "ms");
+    Benchmark::report(std::to_string(pool.concurrency()) + " threads: wall", parallelSeconds * 1000, "ms");
+    Benchmark::report("slowest file", slowestFile * 1000, "ms");
+
+    for (const auto& path : paths) {
+        std::remove(path.c_str());
+    }
+    std::remove(directory.c_str());
+}
@@ -0,0 +1,31 @@
+#include "benchmark.hpp"
+#include "template.hpp"
+
+namespace {
+    void compareTreeAndProgram(const std::string& label, const Liquid::String& source, const Liquid::Data& data) {
+        Liquid::Template tree;
+        tree.parse(source);
+        Liquid::Template compiled;
+        compiled.parse(source).compile();
+
+        const double treeSeconds = Benchmark::measure([&] {
+            (void)tree.render(data);
+        });
+        const double compiledSeconds = Benchmark::measure([&] {
+            (void)compiled.render(data);
+        });
+        Benchmark::report(label + ": tree renders/s", 1 / treeSeconds, "");
+        Benchmark::report(label + ": compiled renders/s", 1 / compiledSeconds, "");
+        Benchmark::report(label + ": speedup", treeSeconds / compiledSeconds, "x");
+    }
+}
+
+BENCHMARK_CASE(Bytecode) {
+    compareTreeAndProgram("catalog", Benchmark::catalogTemplate(), Benchmark::catalogData(100));
+
+    Liquid::Data data(Liquid::Data::Type::Hash);
+    compareTreeAndProgram("nested loops",
+        "{% for i in (1..100) %}{% for j in (1..20) %}{% if j > 15 %}{% break %}{% endif %}"
+        "{% unless j == 3 %}{{ j }},{% endunless %}{% endfor %}\n{% endfor %}",
+        data);
+}
@@ -0,0 +1,45 @@
+#include "benchmark.hpp"
+#include "template.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+BENCHMARK_CASE(ConcurrentRender) {
+    Liquid::Template tmpl;
+    tmpl.parse(Benchmark::catalogTemplate());
+    const Liquid::Data data = Benchmark::catalogData(100);
+
+    const unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    const auto duration = std::chrono::milliseconds(500);
+    double singleThreaded = 0;
+    for (unsigned int threadCount = 1; threadCount <= cores; threadCount *= 2) {
+        std::atomic<bool> stop(false);
+        std::atomic<size_t> renders(0);
+        std::vector<std::thread> threads;
+        for (unsigned int i = 0; i < threadCount; ++i) {
+            threads.emplace_back([&] {
+                size_t count = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    (void)tmpl.render(data);
+                    ++count;
+                }
+                renders += count;
+            });
+        }
+        std::this_thread::sleep_for(duration);
+        stop = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        const double perSecond = renders / std::chrono::duration<double>(duration).count();
+        if (threadCount == 1) {
+            singleThreaded = perSecond;
+        }
+        Benchmark::report(std::to_string(threadCount) + " thread(s): renders/s", perSecond, "");
+        Benchmark::report(std::to_string(threadCount) + " thread(s): speedup", perSecond / singleThreaded, "x");
+        if (threadCount < cores && threadCount * 2 > cores) {
+            threadCount = cores / 2;
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#include "benchmark.hpp"
+
+// Heap used by a catalog of a million products and by an array of a million
+// numbers.
+BENCHMARK_CASE(DataMemory) {
+    const int products = 1000000;
+    const size_t catalogStart = Benchmark::allocations().liveBytes;
+    Liquid::Data catalog = Benchmark::catalogData(products);
+    const size_t catalogBytes = Benchmark::allocations().liveBytes - catalogStart;
+
+    const size_t numbersStart = Benchmark::allocations().liveBytes;
+    Liquid::Data numbers{Liquid::Data::Type::Array};
+    numbers.array().reserve(1000000);
+    for (int i = 0; i < 1000000; ++i) {
+        numbers.push_back(i);
+    }
+    const size_t numbersBytes = Benchmark::allocations().liveBytes - numbersStart;
+
+    Benchmark::report("sizeof(Data)", static_cast<double>(sizeof(Liquid::Data)), "bytes");
+    Benchmark::report("catalog of 1000000 products", static_cast<double>(catalogBytes) / (1024 * 1024), "MB");
+    Benchmark::report("per product", static_cast<double>(catalogBytes) / products, "bytes");
+    Benchmark::report("array of 1000000 numbers", static_cast<double>(numbersBytes) / (1024 * 1024), "MB");
+}
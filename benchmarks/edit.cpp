@@ -0,0 +1,34 @@
+#include "benchmark.hpp"
+#include "template.hpp"
+#include <stdexcept>
+
+BENCHMARK_CASE(IncrementalEdit) {
+    // A single character typed into the middle of a large template and
+    // removed again, against parsing the edited source from scratch.
+    const Liquid::String part = Benchmark::catalogTemplate();
+    Liquid::String source;
+    while (source.size() < 500 * 1024) {
+        source += part;
+    }
+    Liquid::Template tmpl;
+    tmpl.parse(source);
+    const Liquid::String::size_type position = tmpl.source().indexOf("</", source.size() / 2);
+    if (position == Liquid::String::npos) {
+        throw std::runtime_error("No edit position in template");
+    }
+
+    const double parseSeconds = Benchmark::measure([&] {
+        Liquid::Template fresh;
+        fresh.parse(source);
+    });
+    const double editSeconds = Benchmark::measure([&] {
+        tmpl.edit(position, 0, "x");
+        tmpl.edit(position, 1, "");
+    }) / 2;
+    if (tmpl.source() != source) {
+        throw std::runtime_error("Edits did not restore the source");
+    }
+    Benchmark::report("template KB", static_cast<double>(source.size()) / 1024, "");
+    Benchmark::report("full parse", parseSeconds * 1e3, "ms");
+    Benchmark::report("single character edit", editSeconds * 1e6, "us");
+}
@@ -0,0 +1,36 @@
+#include "benchmark.hpp"
+#include "template.hpp"
+#include <stdexcept>
+
+BENCHMARK_CASE(ConstantFolding) {
+    // The same filter chains applied to literals, which are folded when
+    // parsing, and to variables holding the same values, which are not.
+    Liquid::String literals;
+    Liquid::String variables;
+    for (int i = 0; i < 50; ++i) {
+        literals += "<p>{{ 'Hello' | upcase | append: '!' }} {{ 19.99 | times: 100 | round }} {{ name }}</p>\n";
+        variables += "<p>{{ greeting | upcase | append: '!' }} {{ price | times: 100 | round }} {{ name }}</p>\n";
+    }
+    Liquid::Data data(Liquid::Data::Type::Hash);
+    data.insert("name", "Steve");
+    data.insert("greeting", "Hello");
+    data.insert("price", 19.99);
+
+    Liquid::Template folded;
+    folded.parse(literals);
+    Liquid::Template unfolded;
+    unfolded.parse(variables);
+    if (folded.render(data) != unfolded.render(data)) {
+        throw std::runtime_error("Folded and unfolded output differ");
+    }
+
+    const double unfoldedSeconds = Benchmark::measure([&] {
+        (void)unfolded.render(data);
+    });
+    const double foldedSeconds = Benchmark::measure([&] {
+        (void)folded.render(data);
+    });
+    Benchmark::report("unfolded renders/s", 1 / unfoldedSeconds, "");
+    Benchmark::report("folded renders/s", 1 / foldedSeconds, "");
+    Benchmark::report("speedup", unfoldedSeconds / foldedSeconds, "x");
+}
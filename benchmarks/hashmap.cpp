@@ -0,0 +1,69 @@
+#include "benchmark.hpp"
+#include <string>
+#include <vector>
+
+// Records shaped like product data: 40 keys each, mostly short strings and
+// numbers. Reports the heap used per record and the cost of looking keys up
+// by name and by interned symbol.
+BENCHMARK_CASE(HashMap) {
+    const int records = 20000;
+    const int keysPerRecord = 40;
+    std::vector<Liquid::String> keys;
+    std::vector<Liquid::Symbol> symbols;
+    for (int k = 0; k < keysPerRecord; ++k) {
+        keys.push_back(Liquid::String("field_" + std::to_string(k)));
+        symbols.push_back(Liquid::Symbol(keys.back()));
+    }
+
+    Liquid::Data list{Liquid::Data::Type::Array};
+    list.array().reserve(records);
+    const auto build = [&](bool reserve) {
+        list.array().clear();
+        for (int i = 0; i < records; ++i) {
+            Liquid::Data record{Liquid::Data::Type::Hash};
+            if (reserve) {
+                record.hash().reserve(keysPerRecord);
+            }
+            for (int k = 0; k < keysPerRecord; ++k) {
+                if (k % 2) {
+                    record.insert(keys[k], i + k);
+                } else {
+                    record.insert(keys[k], Liquid::String("value"));
+                }
+            }
+            list.push_back(std::move(record));
+        }
+        return Benchmark::allocations().liveBytes;
+    };
+    const size_t start = Benchmark::allocations().liveBytes;
+    const size_t reservedBytes = build(true) - start;
+    const double buildSeconds = Benchmark::measure([&] {
+        (void)build(false);
+    }, 0);
+    const size_t bytes = Benchmark::allocations().liveBytes - start;
+
+    const double lookups = static_cast<double>(records) * keysPerRecord;
+    size_t found = 0;
+    const double nameSeconds = Benchmark::measure([&] {
+        for (const auto& record : list.array()) {
+            for (const auto& key : keys) {
+                found += !record[key].isNil();
+            }
+        }
+    });
+    const double symbolSeconds = Benchmark::measure([&] {
+        for (const auto& record : list.array()) {
+            for (const auto& symbol : symbols) {
+                found += !record[symbol].isNil();
+            }
+        }
+    });
+    if (found == 0) {
+        Benchmark::report("no keys found", 0, "");
+    }
+    Benchmark::report("bytes per record", static_cast<double>(bytes) / records, "bytes");
+    Benchmark::report("bytes per record, reserved", static_cast<double>(reservedBytes) / records, "bytes");
+    Benchmark::report("build: ns per key", buildSeconds * 1e9 / lookups, "ns");
+    Benchmark::report("lookup by name", nameSeconds * 1e9 / lookups, "ns");
+    Benchmark::report("lookup by symbol", symbolSeconds * 1e9 / lookups, "ns");
+}
@@ -0,0 +1,52 @@
+#include "benchmark.hpp"
+#include "template.hpp"
+
+// Variable lookups inside nested loops, where each name is looked up
+// through the loop scopes before it reaches the data.
+BENCHMARK_CASE(Lookups) {
+    Liquid::Template tmpl;
+    tmpl.parse(
+        "{% assign currency = shop.currency %}"
+        "{% for product in products %}{% for variant in product.variants %}"
+        "{{ product.variants.first.price }}{{ variant.price }}{{ variant.sku }}"
+        "{{ product.title }}{{ shop.name }}{{ currency }}{{ forloop.index }}"
+        "{% endfor %}{% endfor %}"
+    );
+    // Each variant takes 15 key lookups, one per name in the body.
+    const int lookupsPerVariant = 15;
+    const int products = 200;
+    const int variantsPerProduct = 5;
+
+    Liquid::Data shop{Liquid::Data::Type::Hash};
+    shop.insert("name", "Example Store");
+    shop.insert("currency", "EUR");
+    Liquid::Data list{Liquid::Data::Type::Array};
+    for (int i = 0; i < products; ++i) {
+        Liquid::Data product = Benchmark::catalogData(1)["products"].at(0);
+        Liquid::Data variants{Liquid::Data::Type::Array};
+        for (int j = 0; j < variantsPerProduct; ++j) {
+            Liquid::Data variant{Liquid::Data::Type::Hash};
+            variant.insert("price", 10 + j);
+            variant.insert("sku", Liquid::String("SKU-" + std::to_string(i * variantsPerProduct + j)));
+            variant.insert("available", true);
+            variants.push_back(std::move(variant));
+        }
+        product.insert("variants", std::move(variants));
+        list.push_back(std::move(product));
+    }
+    Liquid::Data data{Liquid::Data::Type::Hash};
+    data.insert("shop", std::move(shop));
+    data.insert("products", std::move(list));
+
+    const double lookups = static_cast<double>(products) * variantsPerProduct * lookupsPerVariant;
+    (void)tmpl.render(data);
+    const double seconds = Benchmark::measure([&] {
+        (void)tmpl.render(data);
+    });
+    tmpl.compile();
+    const double compiledSeconds = Benchmark::measure([&] {
+        (void)tmpl.render(data);
+    });
+    Benchmark::report("tree: ns per lookup", seconds * 1e9 / lookups, "ns");
+    Benchmark::report("compiled: ns per lookup", compiledSeconds * 1e9 / lookups, "ns");
+}
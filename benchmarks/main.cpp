@@ -0,0 +1,15 @@
+#include "benchmark.hpp"
+#include <iostream>
+
+// Usage: CppLiquid-STD-Bench [name-filter]
+int main(int argc, char* const argv[]) {
+    const std::string filter = argc > 1 ? argv[1] : "";
+    for (const auto& benchmark : Benchmark::cases()) {
+        if (!filter.empty() && benchmark.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        std::cout << benchmark.name << std::endl;
+        benchmark.function();
+    }
+    return 0;
+}
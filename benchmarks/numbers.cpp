@@ -0,0 +1,20 @@
+#include "benchmark.hpp"
+#include "template.hpp"
+
+// Parses a template made mostly of numeric literals: price arithmetic,
+// ranges and comparisons.
+BENCHMARK_CASE(NumberParsing) {
+    Liquid::String source;
+    for (int i = 0; i < 500; ++i) {
+        const std::string n = std::to_string(i);
+        source += ("{% assign price = " + n + ".95 %}{% assign qty = -" + n + " %}"
+            "{{ price | times: 1.2 | plus: 0.05 | minus: 3 | round: 2 }}"
+            "{% if price > 100.5 and qty < 20 %}{{ 19.99 | divided_by: 4 }}{% endif %}"
+            "{% for j in (1.." + n + ") limit: 3 offset: 1 %}{{ j | modulo: 7 }}{% endfor %}\n").c_str();
+    }
+    Liquid::Template tmpl;
+    const double seconds = Benchmark::measure([&] {
+        tmpl.parse(source);
+    });
+    Benchmark::report("parse", static_cast<double>(source.size()) / seconds / (1024 * 1024), "MB/s");
+}
@@ -0,0 +1,40 @@
+#include "benchmark.hpp"
+#include "template.hpp"
+#include <stdexcept>
+
+BENCHMARK_CASE(StaticText) {
+    // Markup interleaved with comments and switched-off blocks, against the
+    // same markup written out by hand. After merging, both render the same
+    // number of text nodes.
+    Liquid::String commented;
+    Liquid::String plain;
+    for (int i = 0; i < 50; ++i) {
+        commented += "<div class=\"row\">{% comment %}Row layout{% endcomment %}\n"
+            "  <span>{{ name }}</span>{% if false %}<em>debug</em>{% endif %}\n"
+            "  {% if true %}<hr>{% endif %}{% comment %}Footer{% endcomment %}</div>\n";
+        plain += "<div class=\"row\">\n"
+            "  <span>{{ name }}</span>\n"
+            "  <hr></div>\n";
+    }
+    Liquid::Data data(Liquid::Data::Type::Hash);
+    data.insert("name", "Steve");
+
+    Liquid::Template merged;
+    merged.parse(commented);
+    Liquid::Template handwritten;
+    handwritten.parse(plain);
+    if (merged.render(data) != handwritten.render(data)) {
+        throw std::runtime_error("Merged and handwritten output differ");
+    }
+
+    const double handwrittenSeconds = Benchmark::measure([&] {
+        (void)handwritten.render(data);
+    });
+    const double mergedSeconds = Benchmark::measure([&] {
+        (void)merged.render(data);
+    });
+    Benchmark::report("nodes before", static_cast<double>(merged.optimizationStats().nodesBefore), "");
+    Benchmark::report("nodes after", static_cast<double>(merged.optimizationStats().nodesAfter), "");
+    Benchmark::report("handwritten renders/s", 1 / handwrittenSeconds, "");
+    Benchmark::report("merged renders/s", 1 / mergedSeconds, "");
+}
@@ -0,0 +1,30 @@
+#include "benchmark.hpp"
+#include "template.hpp"
+
+BENCHMARK_CASE(OutputSegments) {
+    Liquid::Template tmpl;
+    tmpl.parse(Benchmark::catalogTemplate());
+    Liquid::Data data = Benchmark::catalogData(1000);
+
+    const double bytesPerChar = sizeof(Liquid::String::value_type);
+    Liquid::String output;
+    const double stringSeconds = Benchmark::measure([&] {
+        output = tmpl.render(data);
+    });
+    // Rendering into a String copies every character of the output.
+    Benchmark::report("output size", output.size() * bytesPerChar / 1024, "KB");
+    Benchmark::report("String: bytes copied per render", output.size() * bytesPerChar / 1024, "KB");
+    Benchmark::report("String: render time", stringSeconds * 1000, "ms");
+
+    Liquid::String::size_type copied = 0;
+    size_t segments = 0;
+    const double segmentSeconds = Benchmark::measure([&] {
+        Liquid::SegmentOutputSink sink;
+        tmpl.render(data, sink);
+        copied = sink.copiedSize();
+        segments = sink.segments().size();
+    });
+    Benchmark::report("Segments: bytes copied per render", copied * bytesPerChar / 1024, "KB");
+    Benchmark::report("Segments: segment count", static_cast<double>(segments), "");
+    Benchmark::report("Segments: render time", segmentSeconds * 1000, "ms");
+}
@@ -0,0 +1,69 @@
+#include "benchmark.hpp"
+#include "template.hpp"
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+// Parses a generated 10 MB template: the catalog page repeated, with its
+// objects and tags.
+BENCHMARK_CASE(Parse) {
+    const Liquid::String page = Benchmark::catalogTemplate();
+    Liquid::String source;
+    while (source.size() < 10 * 1024 * 1024) {
+        source += page;
+    }
+    Liquid::Template tmpl;
+    const double seconds = Benchmark::measure([&] {
+        tmpl.parse(source);
+    }, 2);
+    Benchmark::report("parse", static_cast<double>(source.size()) / seconds / (1024 * 1024), "MB/s");
+    Benchmark::report("nodes", static_cast<double>(tmpl.optimizationStats().nodesAfter), "");
+}
+
+// The same template from a file: read into a string and copied into the
+// template, against parsed from the mapped file, which the template keeps as
+// its source. Also reports the heap each template holds on to afterwards.
+BENCHMARK_CASE(ParseFile) {
+    const std::string path = "cppliquid-bench-parse.liquid";
+    const Liquid::String page = Benchmark::catalogTemplate();
+    std::string contents;
+    while (contents.size() < 10 * 1024 * 1024) {
+        contents += page.toStdString();
+    }
+    {
+        std::ofstream out(path.c_str(), std::ios::binary);
+        out << contents;
+    }
+    const double megabytes = static_cast<double>(contents.size()) / (1024 * 1024);
+    const auto readAndParse = [&path](Liquid::Template& tmpl) {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        const std::string bytes = buffer.str();
+        const Liquid::String source = Liquid::String::fromUtf8(bytes.data(), bytes.size());
+        tmpl.parse(source);
+    };
+    const auto heldBytes = [](const std::function<void(Liquid::Template&)>& parse) {
+        const size_t start = Benchmark::allocations().liveBytes;
+        Liquid::Template tmpl;
+        parse(tmpl);
+        return static_cast<double>(Benchmark::allocations().liveBytes - start) / (1024 * 1024);
+    };
+    Liquid::Template tmpl;
+    const double readSeconds = Benchmark::measure([&] {
+        readAndParse(tmpl);
+    }, 2);
+    const double mappedSeconds = Benchmark::measure([&] {
+        tmpl.parseFile(path);
+    }, 2);
+    const double readHeld = heldBytes(readAndParse);
+    const double mappedHeld = heldBytes([&path](Liquid::Template& t) {
+        t.parseFile(path);
+    });
+    std::remove(path.c_str());
+    Benchmark::report("read and parse", megabytes / readSeconds, "MB/s");
+    Benchmark::report("parseFile", megabytes / mappedSeconds, "MB/s");
+    Benchmark::report("read and parse: heap held", readHeld, "MB");
+    Benchmark::report("parseFile: heap held", mappedHeld, "MB");
+}
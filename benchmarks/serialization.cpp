@@ -0,0 +1,51 @@
+#include "benchmark.hpp"
+#include "template.hpp"
+#include <cstdio>
+
+// Cold start of a theme: every template is either parsed from source or
+// loaded from its serialized form, in memory or from a file.
+BENCHMARK_CASE(ColdStart) {
+    const int kTemplates = 400;
+    std::vector<Liquid::String> sources;
+    for (int i = 0; i < kTemplates; ++i) {
+        sources.push_back(Benchmark::catalogTemplate() + Liquid::String(("{{ section" + std::to_string(i) + " }}").c_str()));
+    }
+
+    std::vector<std::string> serialized;
+    std::vector<std::string> paths;
+    for (int i = 0; i < kTemplates; ++i) {
+        Liquid::Template tmpl;
+        tmpl.parse(sources[i]);
+        serialized.push_back(tmpl.serialize());
+        paths.push_back("cppliquid-bench-" + std::to_string(i) + ".bin");
+        tmpl.saveFile(paths.back());
+    }
+
+    // Constructing a Template (registering the standard filters and tags)
+    // costs the same either way, so it is kept out of the measurements.
+    std::vector<Liquid::Template> templates(kTemplates);
+    const double parseSeconds = Benchmark::measure([&] {
+        for (int i = 0; i < kTemplates; ++i) {
+            templates[i].parse(sources[i]);
+        }
+    });
+    const double deserializeSeconds = Benchmark::measure([&] {
+        for (int i = 0; i < kTemplates; ++i) {
+            templates[i].deserialize(serialized[i].data(), serialized[i].size());
+        }
+    });
+    const double loadFileSeconds = Benchmark::measure([&] {
+        for (int i = 0; i < kTemplates; ++i) {
+            templates[i].loadFile(paths[i]);
+        }
+    });
+    for (const auto& path : paths) {
+        std::remove(path.c_str());
+    }
+
+    const std::string count = std::to_string(kTemplates);
+    Benchmark::report("parse " + count + " templates", parseSeconds * 1000, "ms");
+    Benchmark::report("deserialize " + count + " templates", deserializeSeconds * 1000, "ms");
+    Benchmark::report("loadFile " + count + " templates", loadFileSeconds * 1000, "ms");
+    Benchmark::report("serialized size / source size", static_cast<double>(serialized[0].size()) / sources[0].size(), "x");
+}
@@ -0,0 +1,44 @@
+#include "benchmark.hpp"
+#include "tokenizer.hpp"
+
+namespace {
+    
+    void reportThroughput(const std::string& label, const Liquid::String& source) {
+        const double seconds = Benchmark::measure([&] {
+            Liquid::Tokenizer tokenizer(source);
+            while (tokenizer.next()) {
+            }
+        });
+        Benchmark::report(label, static_cast<double>(source.size()) / seconds / (1024 * 1024), "MB/s");
+    }
+    
+}
+
+// Tokenizes multi-megabyte sources: a theme page, the same page with
+// inline CSS and scripts full of lone braces, and one large raw block.
+BENCHMARK_CASE(Tokenizer) {
+    const Liquid::String page = Benchmark::catalogTemplate();
+    const Liquid::String script = "<script>function f(a) { if (a) { return {x: a}; } return {}; }</script>\n"
+        "<style>.a { color: red; } .b { margin: 0 }</style>\n";
+    Liquid::String markup;
+    Liquid::String braces;
+    while (markup.size() < 4 * 1024 * 1024) {
+        markup += page;
+        braces += page;
+        braces += script;
+    }
+    Liquid::String paragraph;
+    while (paragraph.size() < 4096) {
+        paragraph += "Lorem ipsum dolor sit amet, consectetur adipiscing elit.\n";
+    }
+    Liquid::String raw = "{% raw %}";
+    while (raw.size() < 4 * 1024 * 1024) {
+        raw += paragraph;
+        raw += "{% if a %}{{ b }}{% endif %}\n";
+    }
+    raw += "{% endraw %}";
+    
+    reportThroughput("markup", markup);
+    reportThroughput("markup with braces", braces);
+    reportThroughput("raw block", raw);
+}
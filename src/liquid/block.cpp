@@ -1,5 +1,6 @@
 #include "block.hpp"
 #include "error.hpp"
+#include "serializer.hpp"
 
 Liquid::BlockTag::BlockTag(const Context& context, const StringRef& tagName, const StringRef& markup)
     : TagNode(context, tagName, markup)
@@ -7,6 +8,13 @@ Liquid::BlockTag::BlockTag(const Context& context, const StringRef& tagName, con
 {
 }
 
+Liquid::BlockTag::BlockTag(const Context& context, const StringRef& tagName, BinaryReader& reader)
+    : TagNode(context, tagName, reader)
+    , tagName_(tagName)
+{
+    body_.load(context, reader);
+}
+
 void Liquid::BlockTag::parse(const Context& context, Tokenizer& tokenizer)
 {
     while (parseBody(context, &body_, tokenizer)) {
@@ -38,9 +46,26 @@ bool Liquid::BlockTag::parseBody(const Context& context, BlockBody* body, Tokeni
     return ret;
 }
 
-Liquid::String Liquid::BlockTag::render(Context& context)
+void Liquid::BlockTag::render(Context& context, OutputSink& out) const
+{
+    body_.render(context, out);
+}
+
+void Liquid::BlockTag::visitBodies(const std::function<void(BlockBody&)>& visitor)
+{
+    visitor(body_);
+}
+
+void Liquid::BlockTag::shiftSource(const String* source, std::ptrdiff_t delta)
+{
+    tagName_.shift(source, delta);
+    TagNode::shiftSource(source, delta);
+}
+
+void Liquid::BlockTag::serialize(BinaryWriter& writer) const
 {
-    return body_.render(context);
+    TagNode::serialize(writer);
+    body_.serialize(writer);
 }
 
 
@@ -9,12 +9,16 @@ namespace Liquid {
     class BlockTag : public TagNode {
     public:
         BlockTag(const Context& context, const StringRef& tagName, const StringRef& markup);
+        BlockTag(const Context& context, const StringRef& tagName, BinaryReader& reader);
         
         virtual void parse(const Context& context, Tokenizer& tokenizer);
         
         bool parseBody(const Context& context, BlockBody* body, Tokenizer& tokenizer);
         
-        virtual String render(Context& context) override;
+        virtual void render(Context& context, OutputSink& out) const override;
+        virtual void serialize(BinaryWriter& writer) const override;
+        virtual void shiftSource(const String* source, std::ptrdiff_t delta) override;
+        virtual void visitBodies(const std::function<void(BlockBody&)>& visitor) override;
         
     protected:
         virtual void handleUnknownTag(const StringRef& tagName, const StringRef& markup, Tokenizer& tokenizer);
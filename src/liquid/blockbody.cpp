@@ -3,6 +3,8 @@
 #include "stringscanner.hpp"
 #include "context.hpp"
 #include "error.hpp"
+#include "serializer.hpp"
+#include "program.hpp"
 
 void Liquid::BlockBody::defaultUnknownTagHandler(const StringRef& tagName, const StringRef&, Tokenizer&)
 {
@@ -11,47 +13,223 @@ void Liquid::BlockBody::defaultUnknownTagHandler(const StringRef& tagName, const
     }
 }
 
-void Liquid::BlockBody::parse(const Context& context, Tokenizer& tokenizer, const UnknownTagHandler unknownTagHandler) {
+namespace {
+    size_t countNodes(Liquid::Node& node) {
+        size_t count = 1;
+        node.visitBodies([&count](Liquid::BlockBody& body) {
+            count += body.nodeCount();
+        });
+        return count;
+    }
+}
+
+void Liquid::BlockBody::parse(const Context& context, Tokenizer& tokenizer, const UnknownTagHandler unknownTagHandler, std::vector<SourceSpan>* spans) {
     nodes_.clear();
-    const Component *comp = nullptr;
-    const auto& tags = context.tags();
-    while ((comp = tokenizer.next()) != nullptr) {
-        switch (comp->type) {
-            case Component::Type::Text:
-                nodes_.push_back(std::make_shared<TextNode>(context, comp->text));
-                break;
-            case Component::Type::Object:
-                nodes_.push_back(std::make_shared<ObjectNode>(context, Variable(comp->innerText)));
-                break;
-            case Component::Type::Tag: {
-                StringScanner ss(comp->innerText);
-                const StringRef tagName = ss.scanIdentifier();
-                const StringRef markup = comp->innerText.mid(ss.position());
-                const auto tag = tags.find(tagName.toString());
-                if (tag != tags.end()) {
-                    nodes_.push_back(tag->second(context, tagName, markup, tokenizer));
-                } else {
-                    unknownTagHandler(tagName, markup, tokenizer);
-                    return;
-                }
-                break;
+    while (parseNext(context, tokenizer, unknownTagHandler, spans)) {
+    }
+}
+
+bool Liquid::BlockBody::parseNext(const Context& context, Tokenizer& tokenizer, const UnknownTagHandler& unknownTagHandler, std::vector<SourceSpan>* spans) {
+    const auto textSize = tokenizer.textSize();
+    const Component *comp = tokenizer.next();
+    if (!comp) {
+        unknownTagHandler(StringRef(), StringRef(), tokenizer);
+        return false;
+    }
+    switch (comp->type) {
+        case Component::Type::Text:
+            nodes_.push_back(std::make_shared<TextNode>(context, comp->text));
+            break;
+        case Component::Type::Object: {
+            Variable var(comp->innerText);
+            var.fold(context);
+            if (var.isConstant()) {
+                nodes_.push_back(std::make_shared<TextNode>(context, var.constant().toString()));
+            } else {
+                nodes_.push_back(std::make_shared<ObjectNode>(context, var));
             }
+            break;
+        }
+        case Component::Type::Tag: {
+            StringScanner ss(comp->innerText);
+            const StringRef tagName = ss.scanIdentifier();
+            const StringRef markup = comp->innerText.mid(ss.position());
+            const auto& tags = context.tags();
+            const auto tag = tags.find(tagName.toString());
+            if (tag == tags.end()) {
+                unknownTagHandler(tagName, markup, tokenizer);
+                return false;
+            }
+            nodes_.push_back(tag->second(context, tagName, markup, tokenizer));
+            break;
         }
     }
-    unknownTagHandler(StringRef(), StringRef(), tokenizer);
+    if (spans) {
+        spans->push_back(SourceSpan{tokenizer.position(), tokenizer.textSize() - textSize, countNodes(*nodes_.back())});
+    }
+    return true;
 }
 
-Liquid::String Liquid::BlockBody::render(Context& context) {
-    String str;
+void Liquid::BlockBody::render(Context& context, OutputSink& out) const {
     for (const auto& node : nodes_) {
-        str += node->render(context);
+        node->render(context, out);
         if (context.haveInterrupt()) {
             break;
         }
     }
+}
+
+Liquid::String Liquid::BlockBody::render(Context& context) const {
+    String str;
+    StringOutputSink out(str);
+    render(context, out);
     return str;
 }
 
+void Liquid::BlockBody::serialize(BinaryWriter& writer) const {
+    writer.writeSize(nodes_.size());
+    for (const auto& node : nodes_) {
+        node->serialize(writer);
+    }
+}
+
+void Liquid::BlockBody::compile(Compiler& compiler) const {
+    for (const auto& node : nodes_) {
+        node->compile(compiler);
+    }
+}
+
+void Liquid::BlockBody::optimize(const Context& context, std::vector<SourceSpan>* spans) {
+    std::vector<NodePtr> nodes;
+    std::vector<SourceSpan> keptSpans;
+    std::vector<NodePtr> run;
+    String runText;
+    SourceSpan runSpan{0, 0, 0};
+    SourceSpan carry{0, 0, 0};
+    bool haveCarry = false;
+    const auto keep = [&](const NodePtr& node, const SourceSpan& span) {
+        nodes.push_back(node);
+        if (spans) {
+            keptSpans.push_back(SourceSpan{span.end, span.textSize + carry.textSize, span.parsedNodes + carry.parsedNodes});
+            carry = SourceSpan{0, 0, 0};
+            haveCarry = false;
+        }
+    };
+    const auto flushRun = [&] {
+        if (run.size() == 1 && std::dynamic_pointer_cast<TextNode>(run.front())) {
+            keep(run.front(), runSpan);
+        } else if (!runText.isEmpty()) {
+            keep(std::make_shared<TextNode>(context, runText), runSpan);
+        } else if (!run.empty()) {
+            carry.textSize += runSpan.textSize;
+            carry.parsedNodes += runSpan.parsedNodes;
+            haveCarry = true;
+        }
+        run.clear();
+        runText = String();
+        runSpan = SourceSpan{0, 0, 0};
+    };
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        const NodePtr& node = nodes_[i];
+        const SourceSpan span = spans ? (*spans)[i] : SourceSpan{0, 0, 0};
+        node->visitBodies([&context](BlockBody& body) {
+            body.optimize(context);
+        });
+        if (node->appendStaticText(context, runText)) {
+            run.push_back(node);
+            runSpan.end = span.end;
+            runSpan.textSize += span.textSize;
+            runSpan.parsedNodes += span.parsedNodes;
+        } else {
+            flushRun();
+            keep(node, span);
+        }
+    }
+    flushRun();
+    if (spans) {
+        // Dropped nodes at the end belong to the last node kept
+        if (haveCarry && !keptSpans.empty()) {
+            keptSpans.back().end = spans->back().end;
+            keptSpans.back().textSize += carry.textSize;
+            keptSpans.back().parsedNodes += carry.parsedNodes;
+        }
+        spans->swap(keptSpans);
+    }
+    nodes_.swap(nodes);
+}
+
+bool Liquid::BlockBody::appendStaticText(const Context& context, String& text) const {
+    String bodyText;
+    for (const auto& node : nodes_) {
+        if (!node->appendStaticText(context, bodyText)) {
+            return false;
+        }
+    }
+    text += bodyText;
+    return true;
+}
+
+size_t Liquid::BlockBody::nodeCount() const {
+    size_t count = nodes_.size();
+    for (const auto& node : nodes_) {
+        node->visitBodies([&count](BlockBody& body) {
+            count += body.nodeCount();
+        });
+    }
+    return count;
+}
+
+size_t Liquid::BlockBody::nodeCount(size_t begin, size_t end) const {
+    size_t count = 0;
+    for (size_t i = begin; i < end; ++i) {
+        count += countNodes(*nodes_[i]);
+    }
+    return count;
+}
+
+void Liquid::BlockBody::replaceNodes(size_t begin, size_t end, BlockBody& body) {
+    nodes_.erase(nodes_.begin() + begin, nodes_.begin() + end);
+    nodes_.insert(nodes_.begin() + begin, body.nodes_.begin(), body.nodes_.end());
+    body.nodes_.clear();
+}
+
+void Liquid::BlockBody::shiftSource(const String* source, std::ptrdiff_t delta) {
+    for (const auto& node : nodes_) {
+        node->shiftSource(source, delta);
+    }
+}
+
+void Liquid::BlockBody::load(const Context& context, BinaryReader& reader) {
+    nodes_.clear();
+    const auto count = reader.readSize();
+    for (uint64_t i = 0; i < count; ++i) {
+        switch (static_cast<Node::Kind>(reader.readByte())) {
+            case Node::Kind::Text:
+                if (reader.readBool()) {
+                    nodes_.push_back(std::make_shared<TextNode>(context, reader.readString()));
+                } else {
+                    nodes_.push_back(std::make_shared<TextNode>(context, reader.readStringRef()));
+                }
+                break;
+            case Node::Kind::Object:
+                nodes_.push_back(std::make_shared<ObjectNode>(context, Variable(reader)));
+                break;
+            case Node::Kind::Tag: {
+                const StringRef tagName = reader.readStringRef();
+                const auto& loaders = reader.tagLoaders();
+                const auto loader = loaders.find(tagName.toString());
+                if (loader == loaders.end()) {
+                    throw serialization_error(String("Unknown tag '%1' in serialized template").arg(tagName.toString()));
+                }
+                nodes_.push_back(loader->second(context, tagName, reader));
+                break;
+            }
+            default:
+                throw serialization_error("Invalid node in serialized template");
+        }
+    }
+}
+
 
 #ifdef TESTS
 
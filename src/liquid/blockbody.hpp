@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <functional>
+#include <cstddef>
 #include "string.hpp"
 #include "node.hpp"
 
@@ -10,15 +11,61 @@ namespace Liquid {
     
     class Tokenizer;
     class Context;
+    class BinaryWriter;
+    class BinaryReader;
+    class Compiler;
+    
+    // Where a top-level node ends in the template source, with the size of
+    // the plain text and the number of nodes parsed for it. Text and nodes
+    // of dropped nodes are counted with the node that follows them.
+    class SourceSpan {
+    public:
+        String::size_type end;
+        String::size_type textSize;
+        size_t parsedNodes;
+    };
 
     class BlockBody {
     public:
         using UnknownTagHandler = std::function<void(const StringRef& tagName, const StringRef& markup, Tokenizer& tokenizer)>;
         static void defaultUnknownTagHandler(const StringRef& tagName, const StringRef& markup, Tokenizer& tokenizer);
         
-        void parse(const Context& context, Tokenizer& tokenizer, const UnknownTagHandler unknownTagHandler = defaultUnknownTagHandler);
+        void parse(const Context& context, Tokenizer& tokenizer, const UnknownTagHandler unknownTagHandler = defaultUnknownTagHandler, std::vector<SourceSpan>* spans = nullptr);
+        
+        // Parses the next component into a node appended to the body.
+        // Returns false at the end of the source or the body.
+        bool parseNext(const Context& context, Tokenizer& tokenizer, const UnknownTagHandler& unknownTagHandler, std::vector<SourceSpan>* spans = nullptr);
+        
+        void render(Context& context, OutputSink& out) const;
+        String render(Context& context) const;
+        
+        void serialize(BinaryWriter& writer) const;
+        void load(const Context& context, BinaryReader& reader);
+        
+        void compile(Compiler& compiler) const;
+        
+        // Replaces each run of nodes that always render the same text, such
+        // as text around a comment, with a single text node, here and in
+        // all nested bodies.
+        // Spans, if given, are merged along with the top-level nodes.
+        void optimize(const Context& context, std::vector<SourceSpan>* spans = nullptr);
+        
+        // Appends what the body renders, if that is always the same.
+        bool appendStaticText(const Context& context, String& text) const;
+        
+        // Number of nodes, including those in nested bodies.
+        size_t nodeCount() const;
+        size_t nodeCount(size_t begin, size_t end) const;
+        
+        const std::vector<NodePtr>& nodes() const {
+            return nodes_;
+        }
+        
+        // Replaces the nodes in [begin, end) with those taken from body.
+        void replaceNodes(size_t begin, size_t end, BlockBody& body);
         
-        String render(Context& context);
+        // Moves all references into source by delta characters.
+        void shiftSource(const String* source, std::ptrdiff_t delta);
         
     private:
         std::vector<NodePtr> nodes_;
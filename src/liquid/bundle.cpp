@@ -0,0 +1,258 @@
+#include "bundle.hpp"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+    
+    using Clock = std::chrono::steady_clock;
+    
+    double secondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    
+    bool endsWith(const std::string& str, const std::string& suffix)
+    {
+        return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+    
+    // Appends the paths, relative to directory, of the files under
+    // directory/relative whose names end with extension. Symlinked and
+    // junctioned directories are not followed, since one pointing at an
+    // ancestor would recurse forever; symlinked files are still listed.
+    void listFiles(const std::string& directory, const std::string& relative, const std::string& extension, std::vector<std::string>& files)
+    {
+        const std::string path = relative.empty() ? directory : directory + "/" + relative;
+        std::vector<std::string> subdirectories;
+#ifdef _WIN32
+        WIN32_FIND_DATAA entry;
+        const HANDLE handle = ::FindFirstFileA((path + "/*").c_str(), &entry);
+        if (handle == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Cannot read " + path);
+        }
+        do {
+            const std::string name = entry.cFileName;
+            if (name == "." || name == "..") {
+                continue;
+            }
+            if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                if (entry.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) {
+                    continue;
+                }
+                subdirectories.push_back(relative + name + "/");
+            } else if (endsWith(name, extension)) {
+                files.push_back(relative + name);
+            }
+        } while (::FindNextFileA(handle, &entry));
+        ::FindClose(handle);
+#else
+        DIR* dir = ::opendir(path.c_str());
+        if (!dir) {
+            throw std::runtime_error("Cannot read " + path);
+        }
+        while (const dirent* entry = ::readdir(dir)) {
+            const std::string name = entry->d_name;
+            if (name == "." || name == "..") {
+                continue;
+            }
+            const std::string entryPath = path + "/" + name;
+            struct stat st;
+            if (::lstat(entryPath.c_str(), &st) != 0) {
+                continue;
+            }
+            if (S_ISLNK(st.st_mode) && (::stat(entryPath.c_str(), &st) != 0 || S_ISDIR(st.st_mode))) {
+                continue;
+            }
+            if (S_ISDIR(st.st_mode)) {
+                subdirectories.push_back(relative + name + "/");
+            } else if (S_ISREG(st.st_mode) && endsWith(name, extension)) {
+                files.push_back(relative + name);
+            }
+        }
+        ::closedir(dir);
+#endif
+        for (const auto& subdirectory : subdirectories) {
+            listFiles(directory, subdirectory, extension, files);
+        }
+    }
+    
+}
+
+Liquid::TemplateBundle Liquid::TemplateBundle::compile(const std::vector<std::string>& paths, Executor& executor, const Configure& configure)
+{
+    const auto start = Clock::now();
+    TemplateBundle bundle;
+    for (const auto& path : paths) {
+        BundleFile file;
+        file.name = path;
+        file.path = path;
+        bundle.files_.push_back(file);
+    }
+    bundle.compileFiles(executor, configure);
+    bundle.wallSeconds_ = secondsSince(start);
+    return bundle;
+}
+
+Liquid::TemplateBundle Liquid::TemplateBundle::compileDirectory(const std::string& directory, Executor& executor, const Configure& configure, const std::string& extension)
+{
+    const auto start = Clock::now();
+    std::vector<std::string> relativePaths;
+    listFiles(directory, std::string(), extension, relativePaths);
+    std::sort(relativePaths.begin(), relativePaths.end());
+    TemplateBundle bundle;
+    for (const auto& relativePath : relativePaths) {
+        BundleFile file;
+        file.name = relativePath.substr(0, relativePath.size() - extension.size());
+        file.path = directory + "/" + relativePath;
+        bundle.files_.push_back(file);
+    }
+    bundle.compileFiles(executor, configure);
+    bundle.wallSeconds_ = secondsSince(start);
+    return bundle;
+}
+
+void Liquid::TemplateBundle::compileFiles(Executor& executor, const Configure& configure)
+{
+    // One task per file: files are large enough units of work, and idle
+    // workers steal from those still parsing big ones.
+    TaskLatch latch(files_.size());
+    for (auto& file : files_) {
+        executor.execute([&file, &configure, &latch] {
+            const auto start = Clock::now();
+            try {
+                const auto tmpl = std::make_shared<Template>();
+                if (configure) {
+                    configure(*tmpl);
+                }
+                tmpl->parseFile(file.path);
+                file.tmpl = tmpl;
+            } catch (const std::exception& e) {
+                file.exception = std::current_exception();
+                file.error = e.what();
+            } catch (...) {
+                file.exception = std::current_exception();
+                file.error = "Unknown error";
+            }
+            file.parseSeconds = secondsSince(start);
+            latch.countDown();
+        });
+    }
+    latch.wait(executor);
+    for (const auto& file : files_) {
+        if (file.succeeded()) {
+            templates_.insert(std::make_pair(file.name, file.tmpl));
+        }
+    }
+}
+
+
+
+#ifdef TESTS
+
+#include "tests.hpp"
+#include "error.hpp"
+#include <cstdio>
+#include <fstream>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+    void makeDirectory(const std::string& path)
+    {
+#ifdef _WIN32
+        (void)_mkdir(path.c_str());
+#else
+        (void)::mkdir(path.c_str(), 0755);
+#endif
+    }
+    
+    void writeFile(const std::string& path, const std::string& contents)
+    {
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        file << contents;
+    }
+}
+
+TEST_CASE("Liquid::TemplateBundle") {
+    
+    const std::string directory = "cppliquid-bundle-test";
+    makeDirectory(directory);
+    makeDirectory(directory + "/snippets");
+    writeFile(directory + "/index.liquid", "Hello {{ name | shout }}");
+    writeFile(directory + "/broken.liquid", "{% if %}");
+    writeFile(directory + "/notes.txt", "not a template");
+    writeFile(directory + "/snippets/price.liquid", "{{ price | plus: 1 }}");
+    const Liquid::TemplateBundle::Configure shout = [](Liquid::Template& tmpl) {
+        tmpl.registerFilter("shout", [](const Liquid::Data& input, const std::vector<Liquid::Data>&) -> Liquid::Data {
+            return input.toString().toUpper();
+        }, true);
+    };
+    Liquid::ThreadPool pool(2);
+    
+    SECTION("Directory") {
+        const Liquid::TemplateBundle bundle = Liquid::TemplateBundle::compileDirectory(directory, pool, shout);
+        REQUIRE(bundle.files().size() == 3);
+        CHECK(bundle.files()[0].name == "broken");
+        CHECK(bundle.files()[1].name == "index");
+        CHECK(bundle.files()[2].name == "snippets/price");
+        CHECK(bundle.files()[2].path == directory + "/snippets/price.liquid");
+        CHECK_FALSE(bundle.files()[0].succeeded());
+        CHECK_FALSE(bundle.files()[0].error.isEmpty());
+        CHECK_THROWS_AS(std::rethrow_exception(bundle.files()[0].exception), Liquid::syntax_error);
+        CHECK(bundle.errorCount() == 1);
+        REQUIRE(bundle.templates().size() == 2);
+        CHECK_DATA_RESULT((*bundle.templates().at("index")), "Hello STEVE", (Liquid::Data::Hash{{"name", "steve"}}));
+        CHECK_DATA_RESULT((*bundle.templates().at("snippets/price")), "11", (Liquid::Data::Hash{{"price", 10}}));
+        for (const auto& file : bundle.files()) {
+            CHECK(file.parseSeconds >= 0);
+            CHECK(file.parseSeconds <= bundle.wallSeconds());
+        }
+        CHECK_THROWS_AS(Liquid::TemplateBundle::compileDirectory(directory + "/missing", pool), std::runtime_error);
+    }
+    
+#ifndef _WIN32
+    SECTION("Symlinks") {
+        const std::string loop = directory + "/snippets/loop";
+        const std::string alias = directory + "/alias.liquid";
+        REQUIRE(::symlink("..", loop.c_str()) == 0);
+        REQUIRE(::symlink("index.liquid", alias.c_str()) == 0);
+        const Liquid::TemplateBundle bundle = Liquid::TemplateBundle::compileDirectory(directory, pool, shout);
+        ::unlink(loop.c_str());
+        ::unlink(alias.c_str());
+        REQUIRE(bundle.files().size() == 4);
+        CHECK(bundle.files()[0].name == "alias");
+        CHECK(bundle.files()[3].name == "snippets/price");
+        CHECK_DATA_RESULT((*bundle.templates().at("alias")), "Hello STEVE", (Liquid::Data::Hash{{"name", "steve"}}));
+    }
+#endif
+    
+    SECTION("Paths") {
+        const std::vector<std::string> paths = {directory + "/snippets/price.liquid", directory + "/missing.liquid"};
+        const Liquid::TemplateBundle bundle = Liquid::TemplateBundle::compile(paths, pool);
+        REQUIRE(bundle.files().size() == 2);
+        CHECK(bundle.files()[0].succeeded());
+        CHECK_FALSE(bundle.files()[1].succeeded());
+        CHECK(bundle.templates().count(paths[0]) == 1);
+        CHECK(bundle.errorCount() == 1);
+        CHECK(Liquid::TemplateBundle::compile(std::vector<std::string>(), pool).files().empty());
+    }
+    
+    std::remove((directory + "/index.liquid").c_str());
+    std::remove((directory + "/broken.liquid").c_str());
+    std::remove((directory + "/notes.txt").c_str());
+    std::remove((directory + "/snippets/price.liquid").c_str());
+    std::remove((directory + "/snippets").c_str());
+    std::remove(directory.c_str());
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef LIQUID_BUNDLE_HPP
+#define LIQUID_BUNDLE_HPP
+
+#include "template.hpp"
+#include "executor.hpp"
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Liquid {
+    
+    // Outcome of parsing one file of a bundle.
+    class BundleFile {
+    public:
+        std::string name;
+        std::string path;
+        std::shared_ptr<const Template> tmpl;
+        std::exception_ptr exception;
+        String error;
+        
+        // Time taken to read and parse the file.
+        double parseSeconds = 0;
+        
+        bool succeeded() const {
+            return tmpl != nullptr;
+        }
+    };
+    
+    // A set of template files, such as a theme, parsed in parallel. A file
+    // that cannot be read or parsed does not stop the others; its error is
+    // reported in files(). The compile may be started from a task on the
+    // same executor: the calling thread parses files too while it waits.
+    // Files are parsed with Template::parseFile(), so large ones must be
+    // replaced rather than changed in place while the bundle exists.
+    class TemplateBundle {
+    public:
+        using Configure = std::function<void(Template&)>;
+        
+        // Parses each of paths, named by the path as given. configure is
+        // called on every template before it is parsed, e.g. to register
+        // filters, and must be safe to call from several threads.
+        static TemplateBundle compile(const std::vector<std::string>& paths, Executor& executor, const Configure& configure = Configure());
+        
+        // Parses every file under directory, including subdirectories, whose
+        // name ends with extension. Templates are named by their path
+        // relative to directory, with '/' separators and without the
+        // extension, e.g. "snippets/price". Throws std::runtime_error if the
+        // directory cannot be read.
+        static TemplateBundle compileDirectory(const std::string& directory, Executor& executor, const Configure& configure = Configure(), const std::string& extension = ".liquid");
+        
+        // The templates that parsed successfully, by name.
+        const std::map<std::string, std::shared_ptr<const Template>>& templates() const {
+            return templates_;
+        }
+        
+        // Every file in the order given, or by name for directories.
+        const std::vector<BundleFile>& files() const {
+            return files_;
+        }
+        
+        size_t errorCount() const {
+            return files_.size() - templates_.size();
+        }
+        
+        // Time taken by the whole compile, from listing the files to the
+        // last template being parsed.
+        double wallSeconds() const {
+            return wallSeconds_;
+        }
+        
+    private:
+        std::map<std::string, std::shared_ptr<const Template>> templates_;
+        std::vector<BundleFile> files_;
+        double wallSeconds_ = 0;
+        
+        void compileFiles(Executor& executor, const Configure& configure);
+    };
+    
+}
+
+#endif
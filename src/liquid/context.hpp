@@ -6,10 +6,29 @@
 
 namespace Liquid {
     
+    // A name bound while rendering: a value of its own, or one that lives
+    // elsewhere for as long as the binding does, like a for loop's item.
+    class Binding {
+    public:
+        Data value;
+        const Data* borrowed = nullptr;
+        
+        const Data& get() const {
+            return borrowed ? *borrowed : value;
+        }
+    };
+    
+    // Keyed by symbol, so finding a name doesn't hash it again.
+    using Scope = std::unordered_map<Symbol, Binding, SymbolHash>;
+    
     class Context {
     public:
-        Context(Data& data, const FilterList& filters, const TagHash& tags)
+        // The data is only read, so it can be shared by any number of
+        // renders. Names the template binds live in a stack of scopes over
+        // it.
+        Context(const Data& data, const FilterList& filters, const TagHash& tags)
             : data_(data)
+            , scopes_(1)
             , filters_(filters)
             , tags_(tags)
         {
@@ -19,8 +38,85 @@ namespace Liquid {
             return data_;
         }
         
-        Data& data() {
-            return data_;
+        // Looks name up in the scopes, innermost first, and then in the data.
+        const Data& find(const Symbol& name) const {
+            for (auto scope = scopes_.rbegin(); scope != scopes_.rend(); ++scope) {
+                const auto it = scope->find(name);
+                if (it != scope->end()) {
+                    return it->second.get();
+                }
+            }
+            if (data_.isHash() || data_.isDrop()) {
+                return data_[name];
+            }
+            return kNilData;
+        }
+        
+        // Whether name is found in the scopes bound to a value the binding
+        // holds itself, as assign and capture bind, which binding the name
+        // again frees. Values in the data, or borrowed by a binding, stay
+        // put for the whole render.
+        bool ownsBinding(const Symbol& name) const {
+            for (auto scope = scopes_.rbegin(); scope != scopes_.rend(); ++scope) {
+                const auto it = scope->find(name);
+                if (it != scope->end()) {
+                    return !it->second.borrowed;
+                }
+            }
+            return false;
+        }
+        
+        // For names only known while rendering, like those in brackets.
+        // Interning those would take the symbol table's lock on every
+        // lookup, which concurrent renders would contend for, so the scopes
+        // are searched by hash and name instead; they are usually small.
+        const Data& find(const String& name) const {
+            const std::size_t hash = Data::Hash::hasher()(name);
+            for (auto scope = scopes_.rbegin(); scope != scopes_.rend(); ++scope) {
+                for (const auto& entry : *scope) {
+                    if (entry.first.hash() == hash && entry.first.name() == name) {
+                        return entry.second.get();
+                    }
+                }
+            }
+            if (data_.isHash() || data_.isDrop()) {
+                return data_[name];
+            }
+            return kNilData;
+        }
+        
+        // Binds name in the outermost scope, which lasts for the whole
+        // render, as assign and capture do.
+        void assign(const Symbol& name, Data value) {
+            Binding& binding = scopes_.front()[name];
+            binding.value = std::move(value);
+            binding.borrowed = nullptr;
+        }
+        
+        // Binds name in the innermost scope.
+        void set(const Symbol& name, Data value) {
+            Binding& binding = scopes_.back()[name];
+            binding.value = std::move(value);
+            binding.borrowed = nullptr;
+        }
+        
+        // Binds name in the innermost scope to value itself, which must
+        // outlive the binding.
+        void bind(const Symbol& name, const Data& value) {
+            Binding& binding = scopes_.back()[name];
+            binding.value = Data();
+            binding.borrowed = &value;
+        }
+        
+        void pushScope() {
+            scopes_.emplace_back();
+        }
+        
+        void popScope() {
+            if (scopes_.size() <= 1) {
+                throw std::runtime_error("Can't pop the outermost scope");
+            }
+            scopes_.pop_back();
         }
         
         const FilterList& filters() const {
@@ -39,6 +135,22 @@ namespace Liquid {
             return registers_;
         }
         
+        // Per-render storage for values that are computed during a render
+        // but returned by reference, keyed by the object computing them.
+        // Keeping them here rather than in the parsed template is what allows
+        // one template to be rendered from several threads at once.
+        Data& scratch(const void* owner) {
+            return scratch_[owner];
+        }
+        
+        const Data& intData(int value) {
+            const auto it = intData_.find(value);
+            if (it != intData_.end()) {
+                return it->second;
+            }
+            return intData_.insert(std::make_pair(value, Data(value))).first->second;
+        }
+        
         enum class Interrupt {
             Break,
             Continue,
@@ -62,12 +174,15 @@ namespace Liquid {
         }
         
     private:
-        Data& data_;
+        const Data& data_;
+        std::vector<Scope> scopes_;
         Data::Hash environments_;
         Data::Hash registers_;
         const FilterList& filters_;
         std::vector<Interrupt> interrupts_;
         const TagHash& tags_;
+        std::unordered_map<const void*, Data> scratch_;
+        std::unordered_map<int, Data> intData_;
     };
 
 }
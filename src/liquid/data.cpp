@@ -115,6 +115,16 @@ TEST_CASE("Liquid::Data") {
         CHECK(c["fname"] == "Steve");
         CHECK(c["lname"] == "Jobs");
         CHECK(c["test"] == nullptr);
+        
+        // Values taken from the hash itself while it grows.
+        for (int i = 0; i < 100; ++i) {
+            c.insert(Liquid::String("copy" + std::to_string(i)), c["fname"]);
+            c.insert(Liquid::String("move" + std::to_string(i)), std::move(c.hash()["lname"]));
+            c.hash()["lname"] = "Jobs";
+        }
+        CHECK(c.size() == 202);
+        CHECK(c["copy99"] == "Steve");
+        CHECK(c["move99"] == "Jobs");
     }
     
     SECTION("Drop") {
@@ -122,6 +132,100 @@ TEST_CASE("Liquid::Data") {
         c.insert("drop", std::make_shared<Liquid::Drop>());
         CHECK(c["drop"].isDrop());
     }
+    
+    SECTION("Layout") {
+        // One number or pointer besides the type.
+        CHECK(sizeof(Liquid::Data) <= 16);
+        
+        const Liquid::Data hash(Liquid::Data::Type::Hash);
+        CHECK(hash.hash().empty());
+        CHECK(hash["x"].isNil());
+        CHECK_FALSE(hash.containsKey("x"));
+        const Liquid::Data array(Liquid::Data::Type::Array);
+        CHECK(array.array().empty());
+        CHECK(array.at(0).isNil());
+        CHECK(Liquid::Data(Liquid::Data::Type::String).toString() == "");
+        CHECK(Liquid::Data(Liquid::Data::Type::String) == Liquid::Data(""));
+        CHECK(hash == Liquid::Data(Liquid::Data::Hash()));
+    }
+    
+    SECTION("Move") {
+        Liquid::Data hash(Liquid::Data::Hash{{"a", "text"}});
+        const Liquid::Data* inner = &hash["a"];
+        Liquid::Data moved(std::move(hash));
+        CHECK(hash.isNil());
+        CHECK(&moved["a"] == inner);
+        Liquid::Data target(1);
+        target = std::move(moved);
+        CHECK(moved.isNil());
+        CHECK(&target["a"] == inner);
+        
+        Liquid::Data array(Liquid::Data::Type::Array);
+        Liquid::Data item(Liquid::Data::Hash{{"b", 2}});
+        array.push_back(std::move(item));
+        CHECK(item.isNil());
+        CHECK(array.at(0)["b"].toInt() == 2);
+        
+        // Borrowed access to the string itself.
+        const Liquid::Data& value = *inner;
+        CHECK(&value.string() == &value.string());
+        CHECK(value.string() == "text");
+        CHECK_THROWS_AS(Liquid::Data(1).string(), std::runtime_error);
+    }
+    
+    SECTION("CopiesAreIndependent") {
+        Liquid::Data c = Liquid::Data::Type::Array;
+        c.push_back(Liquid::Data::Hash{{"a", 1}});
+        Liquid::Data copy = c;
+        c.array()[0].insert("a", 2);
+        CHECK(copy.at(0)["a"].toInt() == 1);
+        CHECK(c.at(0)["a"].toInt() == 2);
+        
+        // Assigning a value from inside itself.
+        c = c.at(0);
+        CHECK(c.isHash());
+        CHECK(c["a"].toInt() == 2);
+        c = c["a"];
+        CHECK(c.toInt() == 2);
+        c = "text";
+        CHECK(c.toString() == "text");
+        CHECK(c.toInt() == 0);
+    }
+    
+    SECTION("BorrowedString") {
+        std::weak_ptr<const Liquid::String> watch;
+        Liquid::Data copy;
+        {
+            const auto buffer = std::make_shared<const Liquid::String>("Hello World");
+            watch = buffer;
+            Liquid::Data c(buffer->data() + 6, 5, buffer);
+            CHECK(c.isString());
+            CHECK(c.isBorrowedString());
+            CHECK(c.type() == Liquid::Data::Type::String);
+            CHECK(c.stringSpan().data == buffer->data() + 6);
+            CHECK(c.stringSpan().size == 5);
+            CHECK(c.size() == 5);
+            CHECK(c.toString() == "World");
+            CHECK(c == Liquid::Data("World"));
+            CHECK(Liquid::Data("World") == c);
+            CHECK(c != Liquid::Data("Worlds"));
+            CHECK_THROWS_AS(c.string(), std::runtime_error);
+            const Liquid::Data owned("owned");
+            CHECK(Liquid::String(owned.stringSpan().data, owned.stringSpan().size) == "owned");
+            CHECK(Liquid::Data(1).stringSpan().data == nullptr);
+            CHECK(Liquid::Data(1).stringSpan().size == 0);
+            copy = c;
+        }
+        // Copies share the borrow, which keeps the buffer alive.
+        CHECK_FALSE(watch.expired());
+        CHECK(copy.isBorrowedString());
+        CHECK(copy.toString() == "World");
+        Liquid::Data moved = std::move(copy);
+        CHECK(moved.isBorrowedString());
+        CHECK_FALSE(copy.isBorrowedString());
+        moved = 1;
+        CHECK(watch.expired());
+    }
 
 }
 
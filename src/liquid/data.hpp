@@ -1,9 +1,12 @@
 #ifndef LIQUID_DATA_HPP
 #define LIQUID_DATA_HPP
 
+#include <algorithm>
 #include <memory>
+#include <utility>
 #include <vector>
 #include "stringutils.hpp"
+#include "symbol.hpp"
 #include "drop.hpp"
 
 namespace Liquid {
@@ -34,98 +37,143 @@ namespace Liquid {
         Data()
             : type_(Type::Nil)
         {
+            value_.i = 0;
         }
         
         Data(std::nullptr_t)
-            : type_(Type::Nil)
+            : Data()
         {
         }
         
+        // Hashes, arrays, strings and drops start out empty.
         Data(Type type)
             : type_(type)
         {
+            value_.i = 0;
+            switch (type_) {
+                case Type::NumberFloat:
+                    value_.f = 0;
+                    break;
+                case Type::Hash:
+                case Type::Array:
+                case Type::String:
+                case Type::Drop:
+                    value_.box = nullptr;
+                    break;
+                default:
+                    break;
+            }
         }
         
-        Data(const Data& ctx)
-            : type_(ctx.type_)
+        Data(const Data& other)
+            : type_(other.type_)
+            , borrowed_(other.borrowed_)
+            , value_(other.value_)
         {
             switch (type_) {
                 case Type::Hash:
-                    hash_ = ctx.hash_;
+                    value_.hash = other.value_.hash ? new Hash(*other.value_.hash) : nullptr;
                     break;
                 case Type::Array:
-                    array_ = ctx.array_;
+                    value_.array = other.value_.array ? new Array(*other.value_.array) : nullptr;
                     break;
                 case Type::String:
-                    string_ = ctx.string_;
+                    if (borrowed_) {
+                        value_.borrowed = new BorrowedString(*other.value_.borrowed);
+                    } else {
+                        value_.string = other.value_.string ? new String(*other.value_.string) : nullptr;
+                    }
                     break;
-                case Type::NumberInt:
-                    number_.i = ctx.number_.i;
+                case Type::Drop:
+                    value_.drop = other.value_.drop ? new std::shared_ptr<Drop>(*other.value_.drop) : nullptr;
                     break;
-                case Type::NumberFloat:
-                    number_.f = ctx.number_.f;
+                default:
                     break;
-                case Type::BooleanTrue:
-                case Type::BooleanFalse:
-                case Type::Nil:
+            }
+        }
+        
+        // Takes over other's value, leaving it nil.
+        Data(Data&& other) noexcept
+            : type_(other.type_)
+            , borrowed_(other.borrowed_)
+            , value_(other.value_)
+        {
+            other.type_ = Type::Nil;
+            other.borrowed_ = false;
+            other.value_.i = 0;
+        }
+        
+        ~Data() {
+            switch (type_) {
+                case Type::Hash:
+                    delete value_.hash;
+                    break;
+                case Type::Array:
+                    delete value_.array;
+                    break;
+                case Type::String:
+                    if (borrowed_) {
+                        delete value_.borrowed;
+                    } else {
+                        delete value_.string;
+                    }
                     break;
                 case Type::Drop:
-                    drop_ = ctx.drop_;
+                    delete value_.drop;
+                    break;
+                default:
                     break;
             }
         }
         
-        Data& operator=(const Data& ctx) {
-            if (this != &ctx) {
-                type_ = ctx.type_;
-                switch (type_) {
-                    case Type::Hash:
-                        hash_ = ctx.hash_;
-                        break;
-                    case Type::Array:
-                        array_ = ctx.array_;
-                        break;
-                    case Type::String:
-                        string_ = ctx.string_;
-                        break;
-                    case Type::NumberInt:
-                        number_.i = ctx.number_.i;
-                        break;
-                    case Type::NumberFloat:
-                        number_.f = ctx.number_.f;
-                        break;
-                    case Type::BooleanTrue:
-                    case Type::BooleanFalse:
-                    case Type::Nil:
-                        break;
-                    case Type::Drop:
-                        drop_ = ctx.drop_;
-                }
+        // Copies before releasing the old value, which may contain other.
+        Data& operator=(const Data& other) {
+            if (this != &other) {
+                Data copy(other);
+                swap(copy);
             }
             return *this;
         }
         
+        Data& operator=(Data&& other) noexcept {
+            if (this != &other) {
+                Data moved(std::move(other));
+                swap(moved);
+            }
+            return *this;
+        }
+        
+        void swap(Data& other) noexcept {
+            std::swap(type_, other.type_);
+            std::swap(borrowed_, other.borrowed_);
+            std::swap(value_, other.value_);
+        }
+        
         bool operator==(const Data& other) const {
             if (type_ != other.type_) {
                 return false;
             }
             switch (type_) {
                 case Type::Hash:
-                    return hash_ == other.hash_;
+                    return hashValue() == other.hashValue();
                 case Type::Array:
-                    return array_ == other.array_;
+                    return arrayValue() == other.arrayValue();
                 case Type::String:
-                    return string_ == other.string_;
+                {
+                    const StringSpan text = stringSpan();
+                    const StringSpan otherText = other.stringSpan();
+                    return text.size == otherText.size && std::equal(text.data, text.data + text.size, otherText.data);
+                }
                 case Type::NumberInt:
-                    return number_.i == other.number_.i;
+                    return value_.i == other.value_.i;
                 case Type::NumberFloat:
-                    return number_.f == other.number_.f;
+                    return value_.f == other.value_.f;
                 case Type::BooleanTrue:
                 case Type::BooleanFalse:
                 case Type::Nil:
                     return true;
                 case Type::Drop:
-                    return drop_ == other.drop_;
+                    return dropValue() == other.dropValue();
                 default:
                     return false;
             }
@@ -163,20 +211,50 @@ namespace Liquid {
 
         Data(const Hash& hash)
             : type_(Type::Hash)
-            , hash_(hash)
         {
+            value_.hash = new Hash(hash);
         }
 
         Data(const Array& array)
             : type_(Type::Array)
-            , array_(array)
         {
+            value_.array = new Array(array);
         }
 
         Data(const String& string)
             : type_(Type::String)
-            , string_(string)
         {
+            value_.string = new String(string);
+        }
+        
+        Data(Hash&& hash)
+            : type_(Type::Hash)
+        {
+            value_.hash = new Hash(std::move(hash));
+        }
+
+        Data(Array&& array)
+            : type_(Type::Array)
+        {
+            value_.array = new Array(std::move(array));
+        }
+
+        Data(String&& string)
+            : type_(Type::String)
+        {
+            value_.string = new String(std::move(string));
+        }
+        
+        // A string that stays in a buffer owned elsewhere, like a document
+        // the data was loaded from, instead of being copied. owner keeps the
+        // buffer alive for as long as any copy of the value exists, and may
+        // be null if the buffer outlives the data anyway. The text must not
+        // change while it is borrowed.
+        Data(const String::value_type* text, String::size_type size, std::shared_ptr<const void> owner)
+            : type_(Type::String)
+            , borrowed_(true)
+        {
+            value_.borrowed = new BorrowedString{text, size, std::move(owner)};
         }
         
         Data(const String::base& string)
@@ -192,24 +270,25 @@ namespace Liquid {
         Data(int value)
             : type_(Type::NumberInt)
         {
-            number_.i = value;
+            value_.i = value;
         }
 
         Data(double value)
             : type_(Type::NumberFloat)
         {
-            number_.f = value;
+            value_.f = value;
         }
 
         Data(bool value)
             : type_(value ? Type::BooleanTrue : Type::BooleanFalse)
         {
+            value_.i = 0;
         }
         
         Data(const std::shared_ptr<Drop>& drop)
             : type_(Type::Drop)
-            , drop_(drop)
         {
+            value_.drop = new std::shared_ptr<Drop>(drop);
         }
 
         Type type() const {
@@ -228,6 +307,10 @@ namespace Liquid {
             return type_ == Type::String;
         }
 
+        bool isBorrowedString() const {
+            return type_ == Type::String && borrowed_;
+        }
+
         bool isNumber() const {
             return type_ == Type::NumberInt || type_ == Type::NumberFloat;
         }
@@ -259,14 +342,54 @@ namespace Liquid {
                 case Type::BooleanFalse:
                     return "false";
                 case Type::NumberInt:
-                    return String(std::to_string(number_.i));
+                    return String(std::to_string(value_.i));
                 case Type::NumberFloat:
-                    return doubleToString(number_.f);
+                    return doubleToString(value_.f);
+                case Type::String:
+                    if (borrowed_) {
+                        return String(value_.borrowed->text, value_.borrowed->size);
+                    }
+                    return stringValue();
                 default:
-                    return string_;
+                    return String();
             }
         }
         
+        // The string value itself, unlike toString(), which makes a copy.
+        // Warning: this throws std::runtime_error for borrowed strings
+        // (isBorrowedString()), even though isString() is true for them,
+        // because they have no String to refer to. Code that may see any
+        // string, such as a filter or an output node, must use stringSpan()
+        // or toString() instead.
+        const String& string() const {
+            if (!isString()) {
+                throw std::runtime_error("string() requires a string");
+            }
+            if (borrowed_) {
+                throw std::runtime_error("string() requires a string that is not borrowed");
+            }
+            return stringValue();
+        }
+        
+        struct StringSpan {
+            const String::value_type* data;
+            String::size_type size;
+        };
+        
+        // The characters of a string, borrowed or not, valid while the value
+        // is neither modified nor destroyed. Values that are not strings
+        // give no characters.
+        StringSpan stringSpan() const noexcept {
+            if (!isString()) {
+                return StringSpan{nullptr, 0};
+            }
+            if (borrowed_) {
+                return StringSpan{value_.borrowed->text, value_.borrowed->size};
+            }
+            const String& string = stringValue();
+            return StringSpan{string.data(), string.size()};
+        }
+        
         bool toBool() const {
             return type_ == Type::BooleanTrue ? true : false;
         }
@@ -274,9 +397,9 @@ namespace Liquid {
         int toInt() const {
             switch (type_) {
                 case Type::NumberInt:
-                    return number_.i;
+                    return value_.i;
                 case Type::NumberFloat:
-                    return static_cast<int>(number_.f);
+                    return static_cast<int>(value_.f);
                 default:
                     return 0;
             }
@@ -285,9 +408,9 @@ namespace Liquid {
         double toFloat() const {
             switch (type_) {
                 case Type::NumberInt:
-                    return number_.i;
+                    return value_.i;
                 case Type::NumberFloat:
-                    return number_.f;
+                    return value_.f;
                 default:
                     return 0;
             }
@@ -307,29 +430,34 @@ namespace Liquid {
             if (!isArray()) {
                 throw std::runtime_error("push_back() requires an array");
             }
-            if (isArray()) {
-                array_.push_back(obj);
+            array().push_back(obj);
+        }
+        
+        void push_back(Data&& obj) {
+            if (!isArray()) {
+                throw std::runtime_error("push_back() requires an array");
             }
+            array().push_back(std::move(obj));
         }
         
         void pop_back() {
             if (!isArray()) {
                 throw std::runtime_error("pop_back() requires an array");
             }
-            if (array_.empty()) {
+            if (arrayValue().empty()) {
                 throw std::runtime_error("pop_back() cannot be used on an empty array");
             }
-            array_.pop_back();
+            value_.array->pop_back();
         }
         
         size_t size() const {
             switch (type_) {
                 case Type::Hash:
-                    return hash_.size();
+                    return hashValue().size();
                 case Type::Array:
-                    return array_.size();
+                    return arrayValue().size();
                 case Type::String:
-                    return string_.size();
+                    return borrowed_ ? value_.borrowed->size : stringValue().size();
                 default:
                     return 0;
             }
@@ -339,85 +467,157 @@ namespace Liquid {
             if (!isArray()) {
                 throw std::runtime_error("at() requires an array");
             }
-            if (index >= array_.size()) {
+            const Array& items = arrayValue();
+            if (index >= items.size()) {
                 return kNilData;
             }
-            return array_.at(index);
+            return items[index];
         }
         
         const Array& array() const {
             if (!isArray()) {
                 throw std::runtime_error("array() requires an array");
             }
-            return array_;
+            return arrayValue();
         }
 
         Array& array() {
             if (!isArray()) {
                 throw std::runtime_error("array() requires an array");
             }
-            return array_;
+            if (!value_.array) {
+                value_.array = new Array();
+            }
+            return *value_.array;
         }
         
         const Hash& hash() const {
             if (!isHash()) {
                 throw std::runtime_error("hash() requires an array");
             }
-            return hash_;
+            return hashValue();
         }
 
+        // Inserting into the hash may move its values, which invalidates
+        // references to them, e.g. one taken with operator[] or hash()[key].
         Hash& hash() {
             if (!isHash()) {
                 throw std::runtime_error("hash() requires an array");
             }
-            return hash_;
+            if (!value_.hash) {
+                value_.hash = new Hash();
+            }
+            return *value_.hash;
         }
 
         void insert(const String& key, const Data& value) {
             if (!isHash()) {
                 throw std::runtime_error("insert() requires a hash");
             }
-            hash_[key] = value;
+            // value may live in this hash, which inserting can move.
+            Data copy(value);
+            hash()[key] = std::move(copy);
+        }
+        
+        void insert(const String& key, Data&& value) {
+            if (!isHash()) {
+                throw std::runtime_error("insert() requires a hash");
+            }
+            Data moved(std::move(value));
+            hash()[key] = std::move(moved);
         }
         
         const Data& operator[](const String& key) const {
             if (isHash()) {
-                const auto it = hash_.find(key);
-                if (it == hash_.end()) {
+                if (!value_.hash) {
+                    return kNilData;
+                }
+                const auto it = value_.hash->find(key);
+                if (it == value_.hash->end()) {
                     return kNilData;
                 }
                 return it->second;
             } else if (isDrop()) {
-                return (*drop_)[key];
+                return (*dropValue())[key];
             } else {
                 throw std::runtime_error("[] requires a hash or drop");
             }
         }
         
+        // Looks key up by its interned name, without hashing it again.
+        const Data& operator[](const Symbol& key) const {
+            if (isHash()) {
+                if (!value_.hash) {
+                    return kNilData;
+                }
+                const auto it = value_.hash->find(key.name(), key.hash());
+                if (it == value_.hash->end()) {
+                    return kNilData;
+                }
+                return it->second;
+            }
+            return (*this)[key.name()];
+        }
+        
         bool containsKey(const String& key) const {
             if (!isHash()) {
                 throw std::runtime_error("containsKey requires a hash");
             }
-            return hash_.find(key) != hash_.end();
+            return value_.hash && value_.hash->find(key) != value_.hash->end();
         }
         
         std::shared_ptr<Drop> drop() const {
             if (!isDrop()) {
                 throw std::runtime_error("drop() requires a drop");
             }
-            return drop_;
+            return dropValue();
         }
         
     private:
-        Type type_;
-        Hash hash_;
-        Array array_;
-        String string_;
-        std::shared_ptr<Drop> drop_;
-        union {
+        // Values that do not fit in the union live on the heap, so a Data is
+        // only the type and one pointer or number. A null pointer stands for
+        // an empty value.
+        struct BorrowedString {
+            const String::value_type* text;
+            String::size_type size;
+            std::shared_ptr<const void> owner;
+        };
+        
+        union Value {
             int i;
             double f;
-        } number_;
+            void* box;
+            Hash* hash;
+            Array* array;
+            String* string;
+            BorrowedString* borrowed;
+            std::shared_ptr<Drop>* drop;
+        };
+        
+        const Hash& hashValue() const {
+            static const Hash empty;
+            return value_.hash ? *value_.hash : empty;
+        }
+        
+        const Array& arrayValue() const {
+            static const Array empty;
+            return value_.array ? *value_.array : empty;
+        }
+        
+        const String& stringValue() const {
+            static const String empty;
+            return value_.string ? *value_.string : empty;
+        }
+        
+        std::shared_ptr<Drop> dropValue() const {
+            return value_.drop ? *value_.drop : std::shared_ptr<Drop>();
+        }
+        
+        Type type_;
+        // Whether a string is a BorrowedString; fits in the padding after
+        // type_.
+        bool borrowed_ = false;
+        Value value_;
     };
 
 }
@@ -0,0 +1,147 @@
+#include "delimiters.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIQUID_DELIMITERS_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace {
+    
+    // A delimiter is a first character followed by one of two second
+    // characters.
+    struct Delimiter {
+        char first;
+        char second1;
+        char second2;
+    };
+    
+    const Delimiter kOpen = {'{', '{', '%'};
+    const Delimiter kObjectEnd = {'}', '}', '}'};
+    const Delimiter kTagEnd = {'%', '}', '}'};
+    
+    template <typename Char>
+    size_t findScalar(const Char* data, size_t size, size_t from, const Delimiter& delimiter)
+    {
+        for (size_t i = from; i + 1 < size; ++i) {
+            if (data[i] == delimiter.first && (data[i + 1] == delimiter.second1 || data[i + 1] == delimiter.second2)) {
+                return i;
+            }
+        }
+        return static_cast<size_t>(-1);
+    }
+    
+    template <typename Char>
+    size_t find(const Char* data, size_t size, size_t from, const Delimiter& delimiter)
+    {
+        return findScalar(data, size, from, delimiter);
+    }
+    
+#ifdef LIQUID_DELIMITERS_SSE2
+    inline int countTrailingZeros(unsigned int mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+    
+    // Compares each character and the one after it with the delimiter, 16
+    // pairs at a time.
+    template <>
+    size_t find<char>(const char* data, size_t size, size_t from, const Delimiter& delimiter)
+    {
+        const __m128i first = _mm_set1_epi8(delimiter.first);
+        const __m128i second1 = _mm_set1_epi8(delimiter.second1);
+        const __m128i second2 = _mm_set1_epi8(delimiter.second2);
+        size_t i = from;
+        for (; i + 17 <= size; i += 16) {
+            const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            const __m128i nextChars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+            const __m128i match = _mm_and_si128(
+                _mm_cmpeq_epi8(chars, first),
+                _mm_or_si128(_mm_cmpeq_epi8(nextChars, second1), _mm_cmpeq_epi8(nextChars, second2))
+            );
+            const unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(match));
+            if (mask != 0) {
+                return i + static_cast<size_t>(countTrailingZeros(mask));
+            }
+        }
+        return findScalar(data, size, i, delimiter);
+    }
+#endif
+    
+}
+
+Liquid::String::size_type Liquid::DelimiterScanner::nextOpen(String::size_type from) const
+{
+    return find(source_.data(), source_.size(), from, kOpen);
+}
+
+Liquid::String::size_type Liquid::DelimiterScanner::nextObjectEnd(String::size_type from) const
+{
+    return find(source_.data(), source_.size(), from, kObjectEnd);
+}
+
+Liquid::String::size_type Liquid::DelimiterScanner::nextTagEnd(String::size_type from) const
+{
+    return find(source_.data(), source_.size(), from, kTagEnd);
+}
+
+
+#ifdef TESTS
+
+#include "catch.hpp"
+
+TEST_CASE("Liquid::DelimiterScanner") {
+    
+    SECTION("Positions") {
+        const Liquid::String source = "a{{ b }}{% c %}{x}%}}{{{%";
+        const Liquid::DelimiterScanner scanner(source);
+        const Liquid::String::size_type npos = Liquid::String::npos;
+        CHECK(scanner.nextOpen(0) == 1);
+        CHECK(scanner.nextOpen(2) == 8);
+        CHECK(scanner.nextOpen(9) == 21);
+        CHECK(scanner.nextOpen(22) == 22);
+        CHECK(scanner.nextOpen(24) == npos);
+        CHECK(scanner.nextOpen(1) == 1);
+        CHECK(scanner.nextObjectEnd(0) == 6);
+        CHECK(scanner.nextObjectEnd(7) == 19);
+        CHECK(scanner.nextTagEnd(0) == 13);
+        CHECK(scanner.nextTagEnd(14) == 18);
+        CHECK(scanner.nextTagEnd(19) == npos);
+        CHECK(scanner.nextTagEnd(100) == npos);
+    }
+    
+    SECTION("MatchesScalar") {
+        // Covers delimiters straddling the 16 character blocks and the
+        // scalar tail.
+        const char alphabet[] = "{}%aaaa";
+        unsigned int seed = 1;
+        int mismatches = 0;
+        for (int round = 0; round < 200; ++round) {
+            std::string text;
+            const size_t size = static_cast<size_t>(round) % 70;
+            for (size_t i = 0; i < size; ++i) {
+                seed = seed * 1103515245 + 12345;
+                text += alphabet[(seed >> 16) % 7];
+            }
+            for (size_t from = 0; from <= size; ++from) {
+                for (const Delimiter* delimiter : {&kOpen, &kObjectEnd, &kTagEnd}) {
+                    if (find(text.data(), size, from, *delimiter) != findScalar(text.data(), size, from, *delimiter)) {
+                        ++mismatches;
+                    }
+                }
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+    
+}
+
+#endif
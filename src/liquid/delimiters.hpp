@@ -0,0 +1,44 @@
+#ifndef LIQUID_DELIMITERS_HPP
+#define LIQUID_DELIMITERS_HPP
+
+#include "string.hpp"
+
+namespace Liquid {
+    
+    // Finds "{{", "{%", "}}" and "%}" in a source, 16 characters at a time
+    // with SSE2 where available. Nothing is stored, so a tokenizer that only
+    // searches forward from where the previous match ended looks at each
+    // character once.
+    class DelimiterScanner {
+    public:
+        explicit DelimiterScanner(const StringRef& source)
+            : source_(source)
+        {
+        }
+        
+        explicit DelimiterScanner(const String& source)
+            : source_(&source)
+        {
+        }
+        
+        explicit DelimiterScanner(String&& source) = delete;
+        
+        // Each returns the position of the first delimiter of its kind at
+        // or after from, or String::npos.
+        
+        // "{{" or "{%"
+        String::size_type nextOpen(String::size_type from) const;
+        
+        // "}}"
+        String::size_type nextObjectEnd(String::size_type from) const;
+        
+        // "%}"
+        String::size_type nextTagEnd(String::size_type from) const;
+        
+    private:
+        const StringRef source_;
+    };
+    
+}
+
+#endif
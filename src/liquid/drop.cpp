@@ -3,19 +3,25 @@
 
 const Liquid::Data& Liquid::Drop::operator[](const String& key) const
 {
-    const Data val = load(key);
-    const auto it = storage_.find(key);
-    if (it == storage_.end() || it->second != val) {
-        if (it != storage_.end()) {
-            storage_.erase(it);
-        }
-        return storage_.insert(std::make_pair(key, val)).first->second;
+    Data val = load(key);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = storage_.find(key);
+    if (it == storage_.end()) {
+        it = storage_.emplace(key, std::move(val)).first;
+    } else if (it->second != val) {
+        it->second = std::move(val);
     }
     return it->second;
 }
 
 bool Liquid::Drop::operator==(const Drop& other) const
 {
+    if (this == &other) {
+        return true;
+    }
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    std::unique_lock<std::mutex> otherLock(other.mutex_, std::defer_lock);
+    std::lock(lock, otherLock);
     return storage_ == other.storage_;
 }
 
@@ -3,11 +3,17 @@
 
 #include "string.hpp"
 #include <functional>
+#include <mutex>
 
 namespace Liquid {
     
     class Data;
 
+    // Values loaded on demand. Each lookup loads the key again and keeps
+    // the value so a reference to it can be returned. Lookups may run from
+    // several renders at once, provided load() may too; a key whose value
+    // changes while other renders read it is only meant for drops that
+    // belong to one render, like forloop.
     class Drop {
     public:
         const Data& operator[](const String& key) const;
@@ -18,7 +24,11 @@ namespace Liquid {
         virtual Data load(const String& key) const;
 
     private:
-        mutable StringKeyUnorderedMap<Data> storage_;
+        // Node-based, since the references operator[] returns must survive
+        // loading further keys. The mutex guards the map itself; a stored
+        // value is only written again when a new load differs from it.
+        mutable std::mutex mutex_;
+        mutable std::unordered_map<String, Data, StringKeyUnorderedMap<Data>::hasher> storage_;
     };
     
     class DropHandler : public Drop {
@@ -13,6 +13,22 @@ namespace Liquid {
         }
     };
 
+    class serialization_error : public std::runtime_error {
+    public:
+        serialization_error(const String& what_arg) : std::runtime_error(what_arg.toStdString())
+        {
+        }
+    };
+
+    // Thrown from the output of a render whose Renderer was destroyed
+    // before the render completed, to unwind it.
+    class render_cancelled : public std::runtime_error {
+    public:
+        render_cancelled() : std::runtime_error("render cancelled")
+        {
+        }
+    };
+
 }
 
 #endif
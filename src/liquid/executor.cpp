@@ -0,0 +1,204 @@
+#include "executor.hpp"
+
+namespace {
+    // The pool and queue index of the worker running on the current thread.
+    thread_local const Liquid::ThreadPool* currentPool = nullptr;
+    thread_local size_t currentQueue = 0;
+}
+
+Liquid::ThreadPool::ThreadPool(size_t threadCount)
+    : pending_(0)
+    , nextQueue_(0)
+    , stopping_(false)
+{
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        queues_.emplace_back(new Queue);
+    }
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads_.emplace_back([this, i] {
+            run(i);
+        });
+    }
+}
+
+Liquid::ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void Liquid::ThreadPool::execute(const Task& task)
+{
+    const size_t index = currentPool == this ? currentQueue : nextQueue_++ % queues_.size();
+    Queue& queue = *queues_[index];
+    ++pending_;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(task);
+    }
+    {
+        // Taking the lock orders this with a worker that is about to sleep.
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+    wake_.notify_one();
+}
+
+bool Liquid::ThreadPool::take(size_t index, Task& task)
+{
+    {
+        Queue& own = *queues_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            --pending_;
+            return true;
+        }
+    }
+    const size_t count = queues_.size();
+    for (size_t i = 1; i < count; ++i) {
+        Queue& victim = *queues_[(index + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --pending_;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Liquid::ThreadPool::runPendingTask()
+{
+    Task task;
+    if (!take(currentPool == this ? currentQueue : 0, task)) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+void Liquid::ThreadPool::run(size_t index)
+{
+    currentPool = this;
+    currentQueue = index;
+    for (;;) {
+        Task task;
+        if (take(index, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this] {
+            return pending_ > 0 || stopping_;
+        });
+        if (stopping_ && pending_ == 0) {
+            return;
+        }
+    }
+}
+
+void Liquid::TaskLatch::countDown()
+{
+    // Notify under the lock: the waiter may destroy the latch as soon as
+    // it sees the count reach zero.
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--remaining_ == 0) {
+        finished_.notify_one();
+    }
+}
+
+void Liquid::TaskLatch::wait(Executor& executor)
+{
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (remaining_ == 0) {
+                return;
+            }
+        }
+        // Once nothing is waiting to start, every task of the batch is
+        // running somewhere and blocking is safe.
+        if (!executor.runPendingTask()) {
+            break;
+        }
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_.wait(lock, [this] {
+        return remaining_ == 0;
+    });
+}
+
+
+
+#ifdef TESTS
+
+#include "catch.hpp"
+
+TEST_CASE("Liquid::ThreadPool") {
+
+    SECTION("Execute") {
+        std::atomic<int> sum(0);
+        {
+            Liquid::ThreadPool pool(4);
+            CHECK(pool.concurrency() == 4);
+            for (int i = 1; i <= 1000; ++i) {
+                pool.execute([&sum, i] {
+                    sum += i;
+                });
+            }
+        }
+        CHECK(sum == 500500);
+    }
+
+    SECTION("Nested") {
+        std::atomic<int> count(0);
+        {
+            Liquid::ThreadPool pool(3);
+            for (int i = 0; i < 10; ++i) {
+                pool.execute([&pool, &count] {
+                    for (int j = 0; j < 10; ++j) {
+                        pool.execute([&count] {
+                            ++count;
+                        });
+                    }
+                });
+            }
+        }
+        CHECK(count == 100);
+    }
+
+    SECTION("WaitFromTask") {
+        // The only worker waits for tasks queued behind it.
+        Liquid::ThreadPool pool(1);
+        std::atomic<int> count(0);
+        Liquid::TaskLatch outer(1);
+        pool.execute([&pool, &count, &outer] {
+            Liquid::TaskLatch inner(10);
+            for (int i = 0; i < 10; ++i) {
+                pool.execute([&count, &inner] {
+                    ++count;
+                    inner.countDown();
+                });
+            }
+            inner.wait(pool);
+            CHECK(count == 10);
+            outer.countDown();
+        });
+        outer.wait(pool);
+        CHECK(count == 10);
+    }
+
+}
+
+#endif
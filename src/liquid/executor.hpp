@@ -0,0 +1,98 @@
+#ifndef LIQUID_EXECUTOR_HPP
+#define LIQUID_EXECUTOR_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Liquid {
+
+    // Runs tasks for the parallel APIs (e.g. Template::renderBatch).
+    // Tasks must not throw.
+    class Executor {
+    public:
+        using Task = std::function<void()>;
+
+        virtual ~Executor() {}
+
+        virtual void execute(const Task& task) = 0;
+
+        // Number of tasks that can run at the same time.
+        virtual size_t concurrency() const = 0;
+
+        // Runs one task that is waiting to start on the calling thread and
+        // returns true, or returns false if there is none (or the executor
+        // can't run tasks elsewhere than on its own threads).
+        virtual bool runPendingTask() {
+            return false;
+        }
+    };
+
+    // Waits for a batch of tasks. Each task counts down once it is done.
+    // While the batch is unfinished, wait() runs the executor's waiting
+    // tasks itself instead of only blocking, so a batch can be waited for
+    // from a task on the same executor, even one with a single thread.
+    class TaskLatch {
+    public:
+        explicit TaskLatch(size_t count)
+            : remaining_(count)
+        {
+        }
+
+        void countDown();
+        void wait(Executor& executor);
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable finished_;
+        size_t remaining_;
+    };
+
+    // A fixed-size work-stealing thread pool. Each worker has its own queue:
+    // it takes its own work newest first and, when that runs dry, steals the
+    // oldest work from the other workers. Tasks submitted from a worker go to
+    // that worker's queue, other submissions are spread round-robin.
+    class ThreadPool : public Executor {
+    public:
+        explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+
+        // Waits for all submitted tasks to finish.
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        virtual void execute(const Task& task) override;
+
+        virtual size_t concurrency() const override {
+            return threads_.size();
+        }
+
+        virtual bool runPendingTask() override;
+
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues_;
+        std::vector<std::thread> threads_;
+        std::atomic<size_t> pending_;
+        std::atomic<size_t> nextQueue_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        bool stopping_;
+
+        void run(size_t index);
+        bool take(size_t index, Task& task);
+    };
+
+}
+
+#endif
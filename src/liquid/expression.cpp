@@ -1,5 +1,8 @@
 #include "expression.hpp"
 #include "standardfilters.hpp"
+#include "context.hpp"
+#include "serializer.hpp"
+#include "error.hpp"
 
 Liquid::Expression Liquid::Expression::parse(Parser& parser)
 {
@@ -58,39 +61,114 @@ Liquid::Expression Liquid::Expression::parse(Parser& parser)
     return exp;
 }
 
-const Liquid::Data& Liquid::Expression::evaluate(const Data& data) const
+Liquid::Expression Liquid::Expression::load(BinaryReader& reader)
 {
-    if (isLookupKey()) {
-        if (data.isHash() || data.isDrop()) {
-            const Data& result = data[key()];
-            if (!result.isNil()) {
-                return result;
-            }
+    const uint8_t type = reader.readByte();
+    if (type > static_cast<uint8_t>(Type::LookupBracketKey)) {
+        throw serialization_error("Invalid expression in serialized template");
+    }
+    Expression exp(static_cast<Type>(type));
+    exp.var_ = reader.readData();
+    if (exp.isLookupKey()) {
+        if (!exp.var_.isString()) {
+            throw serialization_error("Invalid expression in serialized template");
         }
-        switch (lookupKeyFilter()) {
-            case LookupKeyFilter::None:
-                break;
-            case LookupKeyFilter::Size: {
-                // Since this function returns a value by reference, and size is dynamic, we need to store it.
-                const int sizeValue = static_cast<int>(StandardFilters::size_imp(data));
-                const auto existingResult = filterResults_.find(sizeValue);
-                if (existingResult != filterResults_.end()) {
-                    return existingResult->second;
-                }
-                return filterResults_.insert(std::make_pair(sizeValue, sizeValue)).first->second;
-            }
-            case LookupKeyFilter::First:
-                return StandardFilters::first_imp(data);
-            case LookupKeyFilter::Last:
-                return StandardFilters::last_imp(data);
+        exp.symbol_ = Symbol(exp.var_.string());
+    }
+    const auto lookupCount = reader.readSize();
+    for (uint64_t i = 0; i < lookupCount; ++i) {
+        exp.lookups_.push_back(load(reader));
+    }
+    const uint8_t filter = reader.readByte();
+    if (filter > static_cast<uint8_t>(LookupKeyFilter::Last)) {
+        throw serialization_error("Invalid expression in serialized template");
+    }
+    exp.filter_ = static_cast<LookupKeyFilter>(filter);
+    return exp;
+}
+
+void Liquid::Expression::serialize(BinaryWriter& writer) const
+{
+    writer.writeByte(static_cast<uint8_t>(type_));
+    writer.writeData(var_);
+    writer.writeSize(lookups_.size());
+    for (const auto& lookup : lookups_) {
+        lookup.serialize(writer);
+    }
+    writer.writeByte(static_cast<uint8_t>(filter_));
+}
+
+const Liquid::Data& Liquid::Expression::evaluateLookupKey(const Data& data, Context& context) const
+{
+    if (data.isHash() || data.isDrop()) {
+        const Data& result = data[symbol_];
+        if (!result.isNil()) {
+            return result;
         }
+    }
+    return evaluateKeyFilter(data, context);
+}
+
+// Names at the top level are looked up through the context's scopes first.
+const Liquid::Data& Liquid::Expression::evaluateRootKey(Context& context) const
+{
+    const Data& result = context.find(symbol_);
+    if (!result.isNil()) {
+        return result;
+    }
+    return evaluateKeyFilter(context.data(), context);
+}
+
+const Liquid::Data& Liquid::Expression::evaluateKeyFilter(const Data& data, Context& context) const
+{
+    switch (lookupKeyFilter()) {
+        case LookupKeyFilter::None:
+            break;
+        case LookupKeyFilter::Size:
+            // Since this function returns a value by reference, and size is dynamic, we need to store it.
+            return context.intData(static_cast<int>(StandardFilters::size_imp(data)));
+        case LookupKeyFilter::First:
+            return StandardFilters::first_imp(data);
+        case LookupKeyFilter::Last:
+            return StandardFilters::last_imp(data);
+    }
+    return kNilData;
+}
+
+namespace {
+    // The text of a string key. Borrowed strings have no String of their
+    // own, so those are copied into scratch.
+    const Liquid::String& keyString(const Liquid::Data& key, Liquid::String& scratch)
+    {
+        if (key.isBorrowedString()) {
+            scratch = key.toString();
+            return scratch;
+        }
+        return key.string();
+    }
+}
+
+const Liquid::Data& Liquid::Expression::evaluate(Context& context) const
+{
+    if (isLookupKey()) {
+        return evaluateRootKey(context);
     } else if (isLookup() || isLookupBracketKey()) {
-        const Data* currentCtx = &data;
+        // Null until the first lookup, which starts from the scopes.
+        const Data* currentCtx = nullptr;
         for (const auto& lookup : lookups()) {
             if (lookup.isLookupBracketKey()) {
-                const Data& bracketResult = lookup.evaluate(data);
-                if (bracketResult.isString() && currentCtx->isHash()) {
-                    const Data& result = (*currentCtx)[bracketResult.toString()];
+                const Data& bracketResult = lookup.evaluate(context);
+                String scratch;
+                if (!currentCtx && bracketResult.isString()) {
+                    const Data& result = context.find(keyString(bracketResult, scratch));
+                    if (result.isNil()) {
+                        return result;
+                    }
+                    currentCtx = &result;
+                } else if (!currentCtx) {
+                    return kNilData;
+                } else if (bracketResult.isString() && currentCtx->isHash()) {
+                    const Data& result = (*currentCtx)[keyString(bracketResult, scratch)];
                     if (result.isNil()) {
                         return result;
                     }
@@ -104,15 +182,22 @@ const Liquid::Data& Liquid::Expression::evaluate(const Data& data) const
                 } else {
                     return kNilData;
                 }
+            } else if (lookup.isLookupKey()) {
+                const Data& result = currentCtx ? lookup.evaluateLookupKey(*currentCtx, context) : lookup.evaluateRootKey(context);
+                if (result.isNil()) {
+                    return result;
+                }
+                currentCtx = &result;
             } else {
-                const Data& result = lookup.evaluate(*currentCtx);
+                // The expression inside brackets, which is evaluated from the top.
+                const Data& result = lookup.evaluate(context);
                 if (result.isNil()) {
                     return result;
                 }
                 currentCtx = &result;
             }
         }
-        return *currentCtx;
+        return currentCtx ? *currentCtx : context.data();
     } else if (isString() || isNumber() || isNil()) {
         return var_;
     } else if (isBoolean()) {
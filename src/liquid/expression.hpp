@@ -6,6 +6,10 @@
 
 namespace Liquid {
     
+    class Context;
+    class BinaryWriter;
+    class BinaryReader;
+    
     class Expression {
     public:
         enum class Type {
@@ -32,32 +36,16 @@ namespace Liquid {
         {
         }
         
-        Expression(const Expression& other)
-            : type_(other.type_)
-            , var_(other.var_)
-            , lookups_(other.lookups_)
-            , filter_(other.filter_)
-            , filterResults_(other.filterResults_)
-        {
-        }
-        
-        Expression& operator=(const Expression& other) {
-            if (this != &other) {
-                type_ = other.type_;
-                var_ = other.var_;
-                lookups_ = other.lookups_;
-                filter_ = other.filter_;
-                filterResults_ = other.filterResults_;
-            }
-            return *this;
-        }
+        Expression(const Expression& other) = default;
+        Expression(Expression&& other) = default;
+        Expression& operator=(const Expression& other) = default;
+        Expression& operator=(Expression&& other) = default;
         
         bool operator==(const Expression& other) const {
             return type_ == other.type_
                 && var_ == other.var_
                 && lookups_ == other.lookups_
                 && filter_ == other.filter_
-                && filterResults_ == other.filterResults_
             ;
         }
         
@@ -147,6 +135,11 @@ namespace Liquid {
             return type_ == Type::LookupBracketKey;
         }
         
+        // Has the same value whatever the data.
+        bool isLiteral() const {
+            return !isLookup() && !isLookupKey() && !isLookupBracketKey();
+        }
+        
         String toString() const {
             return var_.toString();
         }
@@ -165,10 +158,16 @@ namespace Liquid {
         
         void setKey(const String& key) {
             var_ = key;
+            symbol_ = Symbol(key);
         }
         
-        String key() const {
-            return var_.toString();
+        const String& key() const {
+            return var_.string();
+        }
+        
+        // The key, interned when it was set.
+        const Symbol& symbol() const {
+            return symbol_;
         }
         
         const std::vector<Expression>& lookups() const {
@@ -199,16 +198,23 @@ namespace Liquid {
         
         static Expression parse(Parser& parser);
         
-        const Data& evaluate(const Data& data) const;
+        static Expression load(BinaryReader& reader);
+        void serialize(BinaryWriter& writer) const;
+        
+        const Data& evaluate(Context& context) const;
         
         String stringDescription() const;
         
     private:
         Type type_;
         Data var_;
+        Symbol symbol_;
         std::vector<Expression> lookups_;
         LookupKeyFilter filter_ = LookupKeyFilter::None;
-        mutable std::unordered_map<int, Data> filterResults_;
+        
+        const Data& evaluateLookupKey(const Data& data, Context& context) const;
+        const Data& evaluateRootKey(Context& context) const;
+        const Data& evaluateKeyFilter(const Data& data, Context& context) const;
     };
 
 }
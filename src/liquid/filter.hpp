@@ -8,12 +8,22 @@ namespace Liquid {
     
     using FilterHandler = std::function<Data(const Data& input, const std::vector<Data>&)>;
     
-    using FilterList = StringKeyUnorderedMap<FilterHandler>;
+    class FilterDefinition {
+    public:
+        FilterHandler handler;
+        
+        // The result only depends on the input and the arguments, so calls
+        // with literal values can be evaluated once when parsing.
+        bool pure;
+    };
+    
+    using FilterList = StringKeyUnorderedMap<FilterDefinition>;
 
     class Filter {
     public:
         Filter(const StringRef& name, const std::vector<Expression>& args)
             : name_(name)
+            , key_(name.toString())
             , args_(args)
         {
         }
@@ -22,12 +32,22 @@ namespace Liquid {
             return name_;
         }
         
+        // The name as a FilterList key, made once rather than per call.
+        const String& key() const {
+            return key_;
+        }
+        
         const std::vector<Expression>& args() const {
             return args_;
         }
         
+        void shiftSource(const String* source, std::ptrdiff_t delta) {
+            name_.shift(source, delta);
+        }
+        
     private:
-        const StringRef name_;
+        StringRef name_;
+        String key_;
         std::vector<Expression> args_;
     };
     
@@ -0,0 +1,143 @@
+#include "flathashmap.hpp"
+
+
+
+#ifdef TESTS
+
+#include "catch.hpp"
+#include "string.hpp"
+#include <string>
+#include <unordered_map>
+
+namespace {
+    using Map = Liquid::StringKeyUnorderedMap<int>;
+
+    // Every key lands on the same slot, so probing has to walk past them.
+    struct CollidingHash {
+        std::size_t operator()(int) const {
+            return 42;
+        }
+    };
+}
+
+TEST_CASE("Liquid::FlatHashMap") {
+
+    SECTION("InsertAndFind") {
+        Map map;
+        CHECK(map.empty());
+        CHECK(map.find("a") == map.end());
+        map["a"] = 1;
+        map.insert(std::make_pair(Liquid::String("b"), 2));
+        CHECK(map.emplace("c", 3).second);
+        CHECK_FALSE(map.emplace("c", 4).second);
+        CHECK(map.size() == 3);
+        CHECK(map["a"] == 1);
+        CHECK(map.at("b") == 2);
+        CHECK(map.find("c")->second == 3);
+        CHECK(map.count("d") == 0);
+        CHECK_THROWS_AS(map.at("d"), std::out_of_range);
+        const Liquid::String key("b");
+        CHECK(map.find(key, map.hash_function()(key))->second == 2);
+    }
+
+    SECTION("InsertionOrder") {
+        Map map;
+        std::vector<Liquid::String> keys;
+        for (int i = 0; i < 1000; ++i) {
+            keys.push_back(Liquid::String("key" + std::to_string((i * 7919) % 1000)));
+            map[keys.back()] = i;
+        }
+        REQUIRE(map.size() == keys.size());
+        size_t index = 0;
+        for (const auto& entry : map) {
+            CHECK(entry.first == keys[index]);
+            CHECK(entry.second == static_cast<int>(index));
+            ++index;
+        }
+        map["key1"] = -1;
+        CHECK(map.size() == keys.size());
+        CHECK(map.begin()->first == keys[0]);
+    }
+
+    SECTION("Erase") {
+        Map map{{"a", 1}, {"b", 2}, {"c", 3}, {"d", 4}};
+        CHECK(map.erase("b") == 1);
+        CHECK(map.erase("b") == 0);
+        CHECK(map.size() == 3);
+        CHECK(map.find("b") == map.end());
+        CHECK(map["c"] == 3);
+        const auto next = map.erase(map.find("a"));
+        CHECK(next->first == "c");
+        std::vector<Liquid::String> keys;
+        for (const auto& entry : map) {
+            keys.push_back(entry.first);
+        }
+        CHECK(keys == (std::vector<Liquid::String>{"c", "d"}));
+        map.clear();
+        CHECK(map.empty());
+        CHECK(map.find("c") == map.end());
+        map["c"] = 5;
+        CHECK(map["c"] == 5);
+    }
+
+    SECTION("Collisions") {
+        Liquid::FlatHashMap<int, int, CollidingHash> map;
+        for (int i = 0; i < 100; ++i) {
+            map[i] = i * 2;
+        }
+        for (int i = 0; i < 100; ++i) {
+            CHECK(map.at(i) == i * 2);
+        }
+        CHECK(map.find(100) == map.end());
+        CHECK(map.erase(50) == 1);
+        CHECK(map.find(50) == map.end());
+        CHECK(map.at(99) == 198);
+    }
+
+    SECTION("MatchesUnorderedMap") {
+        Map map;
+        std::unordered_map<std::string, int> expected;
+        unsigned int seed = 1;
+        for (int i = 0; i < 20000; ++i) {
+            seed = seed * 1103515245 + 12345;
+            const std::string key = std::to_string((seed >> 8) % 3000);
+            switch ((seed >> 4) % 4) {
+                case 0:
+                case 1:
+                    map[Liquid::String(key)] = i;
+                    expected[key] = i;
+                    break;
+                case 2:
+                    CHECK(map.erase(Liquid::String(key)) == expected.erase(key));
+                    break;
+                case 3: {
+                    const auto it = map.find(Liquid::String(key));
+                    const auto expectedIt = expected.find(key);
+                    REQUIRE((it == map.end()) == (expectedIt == expected.end()));
+                    if (it != map.end()) {
+                        CHECK(it->second == expectedIt->second);
+                    }
+                    break;
+                }
+            }
+        }
+        CHECK(map.size() == expected.size());
+    }
+
+    SECTION("CopyAndCompare") {
+        Map a{{"x", 1}, {"y", 2}};
+        Map b{{"y", 2}, {"x", 1}};
+        CHECK(a == b);
+        Map c = a;
+        c["x"] = 3;
+        CHECK(a != c);
+        CHECK(a["x"] == 1);
+        Map d = std::move(c);
+        CHECK(d["x"] == 3);
+        a.swap(d);
+        CHECK(a["x"] == 3);
+        CHECK(d["x"] == 1);
+    }
+}
+
+#endif
@@ -0,0 +1,310 @@
+#ifndef LIQUID_FLATHASHMAP_HPP
+#define LIQUID_FLATHASHMAP_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace Liquid {
+
+    // An open-addressing hash map that iterates in insertion order.
+    //
+    // The entries live in one vector, in the order they were inserted. A
+    // separate index of slots maps hashes to entries: one control byte per
+    // slot, holding 7 bits of the hash or marking the slot empty, and the
+    // entry's position. Probing walks the control bytes linearly and only
+    // compares a key when its 7 bits match, so a lookup usually touches one
+    // or two cache lines of the index and then the entry itself.
+    //
+    // Unlike std::unordered_map, inserting may move the entries, which
+    // invalidates iterators and references into the map. Erasing keeps the
+    // order and so takes linear time.
+    template <typename Key, typename T, typename Hasher>
+    class FlatHashMap {
+    public:
+        using key_type = Key;
+        using mapped_type = T;
+        using value_type = std::pair<Key, T>;
+        using size_type = std::size_t;
+        using hasher = Hasher;
+        using iterator = typename std::vector<value_type>::iterator;
+        using const_iterator = typename std::vector<value_type>::const_iterator;
+
+        FlatHashMap() = default;
+        FlatHashMap(const FlatHashMap& other) = default;
+        FlatHashMap(FlatHashMap&& other) noexcept = default;
+        FlatHashMap& operator=(const FlatHashMap& other) = default;
+        FlatHashMap& operator=(FlatHashMap&& other) noexcept = default;
+
+        FlatHashMap(std::initializer_list<value_type> values) {
+            reserve(values.size());
+            for (const auto& value : values) {
+                insert(value);
+            }
+        }
+
+        iterator begin() {
+            return entries_.begin();
+        }
+
+        iterator end() {
+            return entries_.end();
+        }
+
+        const_iterator begin() const {
+            return entries_.begin();
+        }
+
+        const_iterator end() const {
+            return entries_.end();
+        }
+
+        const_iterator cbegin() const {
+            return entries_.cbegin();
+        }
+
+        const_iterator cend() const {
+            return entries_.cend();
+        }
+
+        size_type size() const {
+            return entries_.size();
+        }
+
+        bool empty() const {
+            return entries_.empty();
+        }
+
+        hasher hash_function() const {
+            return hasher();
+        }
+
+        void clear() {
+            entries_.clear();
+            std::fill(control_.begin(), control_.end(), kEmpty);
+        }
+
+        // Makes room for count entries without growing the index.
+        void reserve(size_type count) {
+            if (count > capacityFor(slots_.size())) {
+                rehash(slotsFor(count));
+            }
+            entries_.reserve(count);
+        }
+
+        iterator find(const Key& key) {
+            return find(key, hasher()(key));
+        }
+
+        const_iterator find(const Key& key) const {
+            return find(key, hasher()(key));
+        }
+
+        // Finds key by a hash computed beforehand, which must be the one
+        // hash_function() gives for it.
+        iterator find(const Key& key, size_type hash) {
+            const size_type slot = findSlot(key, hash);
+            return slot == kNotFound ? end() : begin() + static_cast<std::ptrdiff_t>(slots_[slot]);
+        }
+
+        const_iterator find(const Key& key, size_type hash) const {
+            const size_type slot = findSlot(key, hash);
+            return slot == kNotFound ? end() : begin() + static_cast<std::ptrdiff_t>(slots_[slot]);
+        }
+
+        size_type count(const Key& key) const {
+            return find(key) == end() ? 0 : 1;
+        }
+
+        T& at(const Key& key) {
+            const auto it = find(key);
+            if (it == end()) {
+                throw std::out_of_range("FlatHashMap::at");
+            }
+            return it->second;
+        }
+
+        const T& at(const Key& key) const {
+            const auto it = find(key);
+            if (it == end()) {
+                throw std::out_of_range("FlatHashMap::at");
+            }
+            return it->second;
+        }
+
+        T& operator[](const Key& key) {
+            const size_type hash = hasher()(key);
+            const size_type slot = findSlot(key, hash);
+            if (slot != kNotFound) {
+                return entries_[slots_[slot]].second;
+            }
+            return add(value_type(key, T()), hash)->second;
+        }
+
+        T& operator[](Key&& key) {
+            const size_type hash = hasher()(key);
+            const size_type slot = findSlot(key, hash);
+            if (slot != kNotFound) {
+                return entries_[slots_[slot]].second;
+            }
+            return add(value_type(std::move(key), T()), hash)->second;
+        }
+
+        std::pair<iterator, bool> insert(const value_type& value) {
+            return insert(value_type(value));
+        }
+
+        std::pair<iterator, bool> insert(value_type&& value) {
+            const size_type hash = hasher()(value.first);
+            const size_type slot = findSlot(value.first, hash);
+            if (slot != kNotFound) {
+                return std::make_pair(begin() + static_cast<std::ptrdiff_t>(slots_[slot]), false);
+            }
+            return std::make_pair(add(std::move(value), hash), true);
+        }
+
+        template <typename... Args>
+        std::pair<iterator, bool> emplace(Args&&... args) {
+            return insert(value_type(std::forward<Args>(args)...));
+        }
+
+        iterator erase(const_iterator pos) {
+            const auto index = pos - cbegin();
+            const auto next = entries_.erase(entries_.begin() + index);
+            rehash(slots_.size());
+            return next;
+        }
+
+        size_type erase(const Key& key) {
+            const auto it = find(key);
+            if (it == end()) {
+                return 0;
+            }
+            (void)erase(const_iterator(it));
+            return 1;
+        }
+
+        void swap(FlatHashMap& other) noexcept {
+            entries_.swap(other.entries_);
+            control_.swap(other.control_);
+            slots_.swap(other.slots_);
+        }
+
+        // Equal when both hold the same keys with the same values, whatever
+        // the order.
+        bool operator==(const FlatHashMap& other) const {
+            if (size() != other.size()) {
+                return false;
+            }
+            for (const auto& entry : entries_) {
+                const auto it = other.find(entry.first);
+                if (it == other.end() || !(it->second == entry.second)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool operator!=(const FlatHashMap& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        static const uint8_t kEmpty = 0x80;
+        static const size_type kNotFound = static_cast<size_type>(-1);
+        static const size_type kMinSlots = 8;
+
+        // The low 7 bits go in the control byte, the rest pick the slot.
+        static uint8_t controlByte(size_type hash) {
+            return static_cast<uint8_t>(hash & 0x7f);
+        }
+
+        static size_type firstSlot(size_type hash, size_type mask) {
+            return (hash >> 7) & mask;
+        }
+
+        // At most 7/8 of the slots are used, so probes stay short.
+        static size_type capacityFor(size_type slotCount) {
+            return slotCount - slotCount / 8;
+        }
+
+        static size_type slotsFor(size_type count) {
+            size_type slotCount = kMinSlots;
+            while (capacityFor(slotCount) < count) {
+                slotCount *= 2;
+            }
+            return slotCount;
+        }
+
+        size_type findSlot(const Key& key, size_type hash) const {
+            if (slots_.empty()) {
+                return kNotFound;
+            }
+            const size_type mask = slots_.size() - 1;
+            const uint8_t control = controlByte(hash);
+            for (size_type slot = firstSlot(hash, mask); ; slot = (slot + 1) & mask) {
+                if (control_[slot] == kEmpty) {
+                    return kNotFound;
+                }
+                if (control_[slot] == control && entries_[slots_[slot]].first == key) {
+                    return slot;
+                }
+            }
+        }
+
+        void insertSlot(size_type hash, uint32_t index) {
+            const size_type mask = slots_.size() - 1;
+            size_type slot = firstSlot(hash, mask);
+            while (control_[slot] != kEmpty) {
+                slot = (slot + 1) & mask;
+            }
+            control_[slot] = controlByte(hash);
+            slots_[slot] = index;
+        }
+
+        iterator add(value_type&& value, size_type hash) {
+            if (entries_.size() + 1 > capacityFor(slots_.size())) {
+                rehash(slotsFor(entries_.size() + 1));
+            }
+            if (entries_.size() == entries_.capacity()) {
+                // Grow by half rather than doubling, and never past what the
+                // index holds: maps of records are usually built once and
+                // kept, so unused room costs more than the extra moves.
+                const size_type grown = std::max<size_type>(4, entries_.size() + entries_.size() / 2);
+                entries_.reserve(std::min(grown, capacityFor(slots_.size())));
+            }
+            const uint32_t index = static_cast<uint32_t>(entries_.size());
+            entries_.push_back(std::move(value));
+            insertSlot(hash, index);
+            return entries_.end() - 1;
+        }
+
+        void rehash(size_type slotCount) {
+            control_.assign(slotCount, kEmpty);
+            slots_.assign(slotCount, 0);
+            const hasher hash;
+            for (size_type i = 0; i < entries_.size(); ++i) {
+                insertSlot(hash(entries_[i].first), static_cast<uint32_t>(i));
+            }
+        }
+
+        std::vector<value_type> entries_;
+        std::vector<uint8_t> control_;
+        std::vector<uint32_t> slots_;
+    };
+
+    template <typename Key, typename T, typename Hasher>
+    const uint8_t FlatHashMap<Key, T, Hasher>::kEmpty;
+
+    template <typename Key, typename T, typename Hasher>
+    const typename FlatHashMap<Key, T, Hasher>::size_type FlatHashMap<Key, T, Hasher>::kNotFound;
+
+    template <typename Key, typename T, typename Hasher>
+    const typename FlatHashMap<Key, T, Hasher>::size_type FlatHashMap<Key, T, Hasher>::kMinSlots;
+
+}
+
+#endif
@@ -24,6 +24,12 @@ namespace {
 std::vector<Liquid::Token> Liquid::Lexer::tokenize(const StringRef& input)
 {
     std::vector<Liquid::Token> tokens;
+    tokenize(input, tokens);
+    return tokens;
+}
+
+void Liquid::Lexer::tokenize(const StringRef& input, std::vector<Token>& tokens)
+{
     const StringRef trimmed = rtrim(input);
     StringScanner ss(trimmed);
     StringRef tok;
@@ -52,7 +58,8 @@ std::vector<Liquid::Token> Liquid::Lexer::tokenize(const StringRef& input)
 
         tok = ss.scanFloat();
         if (!tok.isNull()) {
-            if (tok.at(tok.size() - 1) == '.' && ss.peekch() == ".") {
+            const StringRef nextChar = ss.peekch();
+            if (tok.at(tok.size() - 1) == '.' && !nextChar.isNull() && nextChar.at(0) == '.') {
                 // This is actually an int in a range, so continue processing.
                 ss.advance(-static_cast<int>(tok.size()));
             } else {
@@ -94,8 +101,6 @@ std::vector<Liquid::Token> Liquid::Lexer::tokenize(const StringRef& input)
     }
     
     tokens.emplace_back(Token::Type::EndOfString, StringRef());
-    
-    return tokens;
 }
 
 
@@ -10,6 +10,9 @@ namespace Liquid {
     class Lexer {
     public:
         static std::vector<Token> tokenize(const StringRef& input);
+        
+        // Appends the tokens of input to tokens.
+        static void tokenize(const StringRef& input, std::vector<Token>& tokens);
     };
 
 }
@@ -0,0 +1,109 @@
+#include "mappedfile.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+Liquid::MappedFile::MappedFile(const std::string& path)
+    : data_(nullptr)
+    , size_(0)
+    , mapped_(false)
+{
+#ifndef _WIN32
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == 0) {
+        const size_t size = static_cast<size_t>(st.st_size);
+        if (size >= kMinMappedSize) {
+            void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                data_ = static_cast<const char*>(addr);
+                size_ = size;
+                mapped_ = true;
+                ::close(fd);
+                return;
+            }
+        }
+        // Small files are cheaper to read than to map and unmap.
+        buffer_.resize(size);
+        size_t done = 0;
+        while (done < size) {
+            const ssize_t count = ::read(fd, &buffer_[done], size - done);
+            if (count <= 0) {
+                break;
+            }
+            done += static_cast<size_t>(count);
+        }
+        ::close(fd);
+        if (done == size) {
+            data_ = buffer_.data();
+            size_ = size;
+            return;
+        }
+        buffer_.clear();
+    } else {
+        ::close(fd);
+    }
+#endif
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    buffer_ = contents.str();
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+}
+
+Liquid::MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if (mapped_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
+
+
+
+#ifdef TESTS
+
+#include "tests.hpp"
+#include <cstdio>
+
+TEST_CASE("Liquid::MappedFile") {
+    
+    SECTION("Contents") {
+        const std::string path = "cppliquid-mappedfile-test.bin";
+        for (size_t size : {static_cast<size_t>(0), static_cast<size_t>(100), Liquid::MappedFile::kMinMappedSize * 2}) {
+            std::string contents;
+            for (size_t i = 0; i < size; ++i) {
+                contents += static_cast<char>('a' + i % 26);
+            }
+            {
+                std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+                file << contents;
+            }
+            const Liquid::MappedFile file(path);
+            REQUIRE(file.size() == size);
+            CHECK(std::string(file.data(), file.size()) == contents);
+#ifndef _WIN32
+            CHECK(file.isMapped() == (size >= Liquid::MappedFile::kMinMappedSize));
+#endif
+        }
+        std::remove(path.c_str());
+        CHECK_THROWS_AS(Liquid::MappedFile(path), std::runtime_error);
+    }
+    
+}
+
+#endif
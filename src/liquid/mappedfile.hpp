@@ -0,0 +1,46 @@
+#ifndef LIQUID_MAPPEDFILE_HPP
+#define LIQUID_MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace Liquid {
+    
+    // Read-only view of a whole file. Uses mmap() where available and falls
+    // back to reading the file into memory elsewhere, or for small files.
+    class MappedFile {
+    public:
+        static const size_t kMinMappedSize = 64 * 1024;
+        
+        // Throws std::runtime_error if the file cannot be opened.
+        explicit MappedFile(const std::string& path);
+        ~MappedFile();
+        
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        
+        const char* data() const {
+            return data_;
+        }
+        
+        size_t size() const {
+            return size_;
+        }
+        
+        // Whether data() is the mapped file rather than a copy read from it.
+        // A mapping shows later changes to the file, and accessing it after
+        // the file was truncated raises SIGBUS.
+        bool isMapped() const {
+            return mapped_;
+        }
+        
+    private:
+        const char* data_;
+        size_t size_;
+        bool mapped_;
+        std::string buffer_;
+    };
+    
+}
+
+#endif
@@ -1,15 +1,65 @@
 #include "node.hpp"
 #include "context.hpp"
+#include "serializer.hpp"
+#include "program.hpp"
+#include "blockbody.hpp"
+
+void Liquid::Node::compile(Compiler& compiler) const
+{
+    compiler.emitRender(*this);
+}
+
+void Liquid::Node::shiftSource(const String* source, std::ptrdiff_t delta)
+{
+    visitBodies([source, delta](BlockBody& body) {
+        body.shiftSource(source, delta);
+    });
+}
 
 Liquid::TextNode::TextNode(const Context& context, const StringRef& text)
     : Node(context)
     , text_(text)
 {
 }
+
+Liquid::TextNode::TextNode(const Context& context, const String& text)
+    : Node(context)
+    , ownedText_(text)
+    , text_(&ownedText_)
+{
+}
     
-Liquid::String Liquid::TextNode::render(Context&)
+void Liquid::TextNode::render(Context&, OutputSink& out) const
+{
+    out.appendStatic(text_);
+}
+
+void Liquid::TextNode::serialize(BinaryWriter& writer) const
+{
+    writer.writeByte(static_cast<uint8_t>(Kind::Text));
+    const bool owned = text_.string() == &ownedText_;
+    writer.writeBool(owned);
+    if (owned) {
+        writer.writeString(ownedText_);
+    } else {
+        writer.writeStringRef(text_);
+    }
+}
+
+void Liquid::TextNode::compile(Compiler& compiler) const
+{
+    compiler.emitText(text_);
+}
+
+bool Liquid::TextNode::appendStaticText(const Context&, String& text) const
 {
-    return text_.toString();
+    text_.appendTo(text);
+    return true;
+}
+
+void Liquid::TextNode::shiftSource(const String* source, std::ptrdiff_t delta)
+{
+    text_.shift(source, delta);
 }
     
 Liquid::ObjectNode::ObjectNode(const Context& context, const Variable& var)
@@ -18,14 +68,47 @@ Liquid::ObjectNode::ObjectNode(const Context& context, const Variable& var)
 {
 }
     
-Liquid::String Liquid::ObjectNode::render(Context& context)
+void Liquid::ObjectNode::render(Context& context, OutputSink& out) const
+{
+    const Data& value = var_.evaluate(context);
+    if (value.isString()) {
+        const Data::StringSpan text = value.stringSpan();
+        out.append(text.data, text.size);
+    } else {
+        out.append(value.toString());
+    }
+}
+
+void Liquid::ObjectNode::serialize(BinaryWriter& writer) const
+{
+    writer.writeByte(static_cast<uint8_t>(Kind::Object));
+    var_.serialize(writer);
+}
+
+void Liquid::ObjectNode::compile(Compiler& compiler) const
+{
+    compiler.emitOutput(var_);
+}
+
+void Liquid::ObjectNode::shiftSource(const String* source, std::ptrdiff_t delta)
+{
+    var_.shiftSource(source, delta);
+}
+
+void Liquid::TagNode::render(Context&, OutputSink&) const
+{
+}
+
+void Liquid::TagNode::serialize(BinaryWriter& writer) const
 {
-    return var_.evaluate(context).toString();
+    writer.writeByte(static_cast<uint8_t>(Kind::Tag));
+    writer.writeStringRef(tagName_);
 }
 
-Liquid::String Liquid::TagNode::render(Context&)
+void Liquid::TagNode::shiftSource(const String* source, std::ptrdiff_t delta)
 {
-    return "";
+    tagName_.shift(source, delta);
+    Node::shiftSource(source, delta);
 }
 
 
@@ -3,37 +3,87 @@
 
 #include "variable.hpp"
 #include "string.hpp"
+#include "outputsink.hpp"
+#include <functional>
 #include <memory>
 
 namespace Liquid {
     
     class Context;
     class Tokenizer;
+    class BinaryWriter;
+    class BinaryReader;
+    class Compiler;
+    class BlockBody;
     
     class Node {
     public:
+        enum class Kind {
+            Text,
+            Object,
+            Tag,
+        };
+        
         Node(const Context&) {}
-        virtual String render(Context& context) = 0;
+        virtual void render(Context& context, OutputSink& out) const = 0;
+        
+        // Writes the node in the form BlockBody::load() reads back.
+        virtual void serialize(BinaryWriter& writer) const = 0;
+        
+        // Emits the node's instructions. By default the compiled template
+        // renders the node through render().
+        virtual void compile(Compiler& compiler) const;
+        
+        // Calls visitor with each block body in the node.
+        virtual void visitBodies(const std::function<void(BlockBody&)>&) {
+        }
+        
+        // If rendering the node always produces the same text and has no
+        // other effect, appends that text and returns true.
+        virtual bool appendStaticText(const Context&, String&) const {
+            return false;
+        }
+        
+        // Moves the node's references into source by delta characters,
+        // after text was inserted or removed in front of the node.
+        virtual void shiftSource(const String* source, std::ptrdiff_t delta);
     };
 
     class TextNode : public Node {
     public:
         TextNode(const Context& context, const StringRef& text);
         
-        virtual String render(Context&) override;
+        // Text that is not part of the source, e.g. a folded constant.
+        TextNode(const Context& context, const String& text);
+        
+        // text_ may point at ownedText_, so the node stays where it is.
+        TextNode(const TextNode&) = delete;
+        TextNode(TextNode&&) = delete;
+        TextNode& operator=(const TextNode&) = delete;
+        TextNode& operator=(TextNode&&) = delete;
+        
+        virtual void render(Context&, OutputSink& out) const override;
+        virtual void serialize(BinaryWriter& writer) const override;
+        virtual void compile(Compiler& compiler) const override;
+        virtual bool appendStaticText(const Context&, String& text) const override;
+        virtual void shiftSource(const String* source, std::ptrdiff_t delta) override;
         
     private:
-        const StringRef text_;
+        const String ownedText_;
+        StringRef text_;
     };
     
     class ObjectNode : public Node {
     public:
         ObjectNode(const Context& context, const Variable& var);
 
-        virtual String render(Context& context) override;
+        virtual void render(Context& context, OutputSink& out) const override;
+        virtual void serialize(BinaryWriter& writer) const override;
+        virtual void compile(Compiler& compiler) const override;
+        virtual void shiftSource(const String* source, std::ptrdiff_t delta) override;
 
     private:
-        const Variable var_;
+        Variable var_;
     };
     
     class TagNode : public Node {
@@ -42,12 +92,22 @@ namespace Liquid {
             : Node(context)
             , tagName_(tagName)
         {}
-        virtual String render(Context& context) override;
-        const StringRef& tagName() {
+        TagNode(const Context& context, const StringRef& tagName, BinaryReader&)
+            : Node(context)
+            , tagName_(tagName)
+        {}
+        virtual void render(Context& context, OutputSink& out) const override;
+        
+        // Writes the tag name, which selects the TagLoader, and then the
+        // tag's own state. Subclasses extend this and read the same fields
+        // back, in the same order, in their BinaryReader constructor.
+        virtual void serialize(BinaryWriter& writer) const override;
+        virtual void shiftSource(const String* source, std::ptrdiff_t delta) override;
+        const StringRef& tagName() const {
             return tagName_;
         }
     private:
-        const StringRef tagName_;
+        StringRef tagName_;
     };
     
     using NodePtr = std::shared_ptr<Node>;
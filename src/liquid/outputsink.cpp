@@ -0,0 +1,146 @@
+#include "outputsink.hpp"
+
+void Liquid::StreamOutputSink::append(const String& text)
+{
+    stream_ << text;
+}
+
+void Liquid::StreamOutputSink::append(const StringRef& text)
+{
+#if defined(LIQUID_STRING_USE_STD)
+    stream_.write(text.data(), static_cast<std::streamsize>(text.size()));
+#else
+    stream_ << text.toString();
+#endif
+}
+
+void Liquid::StreamOutputSink::append(const String::value_type* text, String::size_type size)
+{
+#if defined(LIQUID_STRING_USE_STD)
+    stream_.write(text, static_cast<std::streamsize>(size));
+#else
+    stream_ << String(text, size);
+#endif
+}
+
+
+void Liquid::SegmentOutputSink::append(const String& text)
+{
+    append(text.data(), text.size());
+}
+
+void Liquid::SegmentOutputSink::append(const StringRef& text)
+{
+    append(text.data(), text.size());
+}
+
+void Liquid::SegmentOutputSink::append(const String::value_type* text, String::size_type size)
+{
+    if (size == 0) {
+        return;
+    }
+    if (lastSegmentOwned_) {
+        // Grow the previous owned buffer rather than starting a new segment,
+        // which keeps runs of small dynamic values down to a single iovec.
+        String& buffer = buffers_.back();
+        buffer.append(text, size);
+        segments_.back() = Segment{buffer.data(), buffer.size()};
+    } else {
+        buffers_.push_back(String(text, size));
+        const String& buffer = buffers_.back();
+        segments_.push_back(Segment{buffer.data(), buffer.size()});
+        lastSegmentOwned_ = true;
+    }
+    size_ += size;
+    copiedSize_ += size;
+}
+
+void Liquid::SegmentOutputSink::appendStatic(const StringRef& text)
+{
+    if (text.isEmpty()) {
+        return;
+    }
+    if (!segments_.empty() && !lastSegmentOwned_) {
+        Segment& last = segments_.back();
+        if (last.data + last.size == text.data()) {
+            last.size += text.size();
+            size_ += text.size();
+            return;
+        }
+    }
+    segments_.push_back(Segment{text.data(), text.size()});
+    lastSegmentOwned_ = false;
+    size_ += text.size();
+}
+
+Liquid::String Liquid::SegmentOutputSink::toString() const
+{
+    String str;
+    for (const auto& segment : segments_) {
+        str += String(segment.data, segment.size);
+    }
+    return str;
+}
+
+#ifndef _WIN32
+std::vector<struct iovec> Liquid::SegmentOutputSink::iovecs() const
+{
+    std::vector<struct iovec> result;
+    result.reserve(segments_.size());
+    for (const auto& segment : segments_) {
+        struct iovec vec;
+        vec.iov_base = const_cast<String::value_type*>(segment.data);
+        vec.iov_len = segment.size * sizeof(String::value_type);
+        result.push_back(vec);
+    }
+    return result;
+}
+#endif
+
+
+
+#ifdef TESTS
+
+#include "catch.hpp"
+#include <sstream>
+
+TEST_CASE("Liquid::OutputSink") {
+
+    SECTION("String") {
+        const Liquid::String source = "Hello World";
+        Liquid::String output;
+        Liquid::StringOutputSink sink(output);
+        sink.append(source.midRef(0, 5));
+        sink.append(Liquid::String(", "));
+        sink.append(source.midRef(6));
+        CHECK(output == "Hello, World");
+    }
+
+    SECTION("Stream") {
+        const Liquid::String source = "Hello World";
+        std::ostringstream stream;
+        Liquid::StreamOutputSink sink(stream);
+        sink.append(source.midRef(0, 5));
+        sink.append(Liquid::String(", "));
+        sink.append(source.midRef(6));
+        CHECK(stream.str() == "Hello, World");
+    }
+
+    SECTION("Segments") {
+        const Liquid::String source = "Hello World";
+        Liquid::SegmentOutputSink sink;
+        sink.appendStatic(source.midRef(0, 5));
+        sink.append(Liquid::String(","));
+        sink.append(Liquid::String(" "));
+        sink.appendStatic(source.midRef(6));
+        CHECK(sink.toString() == "Hello, World");
+        REQUIRE(sink.segments().size() == 3);
+        CHECK(sink.segments()[0].data == source.data());
+        CHECK(sink.segments()[2].data == source.data() + 6);
+        CHECK(sink.size() == 12);
+        CHECK(sink.copiedSize() == 2);
+    }
+
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef LIQUID_OUTPUTSINK_HPP
+#define LIQUID_OUTPUTSINK_HPP
+
+#include "string.hpp"
+#include <ostream>
+#include <deque>
+#include <vector>
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+namespace Liquid {
+
+    // Receives the output of a render as it is produced, so nodes can write
+    // directly into the caller's buffer instead of returning nested strings.
+    class OutputSink {
+    public:
+        virtual ~OutputSink() {}
+
+        virtual void append(const String& text) = 0;
+
+        virtual void append(const StringRef& text) {
+            append(text.toString());
+        }
+
+        // Text in a buffer the sink doesn't own, like a borrowed string
+        // value. It is only valid during the call.
+        virtual void append(const String::value_type* text, String::size_type size) {
+            append(String(text, size));
+        }
+
+        // Text that refers to the parsed template itself, which stays valid
+        // for as long as the template is neither destroyed nor re-parsed.
+        virtual void appendStatic(const StringRef& text) {
+            append(text);
+        }
+
+        // Hint that about size more characters are going to be appended.
+        virtual void reserve(String::size_type) {
+        }
+    };
+
+    class StringOutputSink : public OutputSink {
+    public:
+        explicit StringOutputSink(String& str)
+            : str_(str)
+        {
+        }
+
+        virtual void append(const String& text) override {
+            str_ += text;
+        }
+
+        virtual void append(const StringRef& text) override {
+            text.appendTo(str_);
+        }
+
+        virtual void append(const String::value_type* text, String::size_type size) override {
+            str_.append(text, size);
+        }
+
+        virtual void reserve(String::size_type size) override {
+            str_.reserve(str_.size() + size);
+        }
+
+    private:
+        String& str_;
+    };
+
+    class StreamOutputSink : public OutputSink {
+    public:
+        explicit StreamOutputSink(std::ostream& stream)
+            : stream_(stream)
+        {
+        }
+
+        virtual void append(const String& text) override;
+        virtual void append(const StringRef& text) override;
+        virtual void append(const String::value_type* text, String::size_type size) override;
+
+    private:
+        std::ostream& stream_;
+    };
+
+    // Collects the output as a list of segments instead of one contiguous
+    // string. Static template text is referenced in place and only dynamic
+    // values are copied, so the result can be handed to writev() as is.
+    class SegmentOutputSink : public OutputSink {
+    public:
+        struct Segment {
+            const String::value_type* data;
+            String::size_type size;
+        };
+
+        virtual void append(const String& text) override;
+        virtual void append(const StringRef& text) override;
+        virtual void append(const String::value_type* text, String::size_type size) override;
+        virtual void appendStatic(const StringRef& text) override;
+
+        const std::vector<Segment>& segments() const {
+            return segments_;
+        }
+
+        // Number of characters in the output.
+        String::size_type size() const {
+            return size_;
+        }
+
+        // Number of characters that were copied into owned buffers.
+        String::size_type copiedSize() const {
+            return copiedSize_;
+        }
+
+        String toString() const;
+
+#ifndef _WIN32
+        std::vector<struct iovec> iovecs() const;
+#endif
+
+    private:
+        std::vector<Segment> segments_;
+        std::deque<String> buffers_;
+        bool lastSegmentOwned_ = false;
+        String::size_type size_ = 0;
+        String::size_type copiedSize_ = 0;
+    };
+
+}
+
+#endif
@@ -1,18 +1,43 @@
 #include "parser.hpp"
 #include "error.hpp"
 
+namespace {
+    // Used as a stack by the parsers alive on the thread. Once it has grown
+    // to the largest nesting of tags seen, parsing allocates no more token
+    // storage.
+    std::vector<Liquid::Token>& threadTokens()
+    {
+        thread_local std::vector<Liquid::Token> tokens;
+        return tokens;
+    }
+}
+
 Liquid::Parser::Parser(const StringRef& input)
-    : tokens_(Lexer::tokenize(input))
+    : tokens_(threadTokens())
+    , begin_(tokens_.size())
+    , size_(0)
     , pos_(0)
 {
+    try {
+        Lexer::tokenize(input, tokens_);
+    } catch (...) {
+        tokens_.erase(tokens_.begin() + static_cast<std::ptrdiff_t>(begin_), tokens_.end());
+        throw;
+    }
+    size_ = tokens_.size() - begin_;
+}
+
+Liquid::Parser::~Parser()
+{
+    tokens_.erase(tokens_.begin() + static_cast<std::ptrdiff_t>(begin_), tokens_.end());
 }
 
 const Liquid::Token& Liquid::Parser::tokenAt(size_t position) const
 {
-    if (tokens_.empty() || position >= tokens_.size()) {
+    if (position >= size_) {
         return kTokenInvalid;
     }
-    return tokens_.at(position);
+    return tokens_[begin_ + position];
 }
 
 
@@ -116,6 +141,26 @@ TEST_CASE("Liquid::Parser") {
         CHECK(p2.consume(Liquid::Token::Type::String) == "Hello");
         CHECK(p2.consume(Liquid::Token::Type::EndOfString).isEmpty());
     }
+    
+    SECTION("Nested") {
+        const Liquid::String outerInput = "a b c";
+        const Liquid::String innerInput = "1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16";
+        Liquid::Parser outer(Liquid::StringRef{&outerInput});
+        CHECK(outer.consume() == "a");
+        {
+            Liquid::Parser inner(Liquid::StringRef{&innerInput});
+            CHECK(inner.consume() == "1");
+            CHECK(outer.consume() == "b");
+            CHECK(inner.consume() == "2");
+            CHECK(inner.look(Liquid::Token::Type::EndOfString, 14));
+            CHECK_FALSE(inner.look(Liquid::Token::Type::EndOfString, 15));
+            const Liquid::String badInput = "1 2 ;";
+            CHECK_THROWS_AS(Liquid::Parser(Liquid::StringRef{&badInput}), Liquid::syntax_error);
+        }
+        CHECK(outer.consume() == "c");
+        CHECK(outer.consume(Liquid::Token::Type::EndOfString).isEmpty());
+        CHECK_FALSE(outer.look(Liquid::Token::Type::EndOfString));
+    }
 }
 
 #endif
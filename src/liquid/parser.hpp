@@ -5,9 +5,17 @@
 
 namespace Liquid {
 
+    // Parsers keep their tokens in a buffer shared by all parsers on the
+    // thread. A tag's parser may be alive while the variables in it are
+    // parsed, so parsers must be destroyed in the reverse order of their
+    // construction, as local variables are.
     class Parser {
     public:
         Parser(const StringRef& input);
+        ~Parser();
+        
+        Parser(const Parser&) = delete;
+        Parser& operator=(const Parser&) = delete;
         
         void jump(size_t position) {
             pos_ = position;
@@ -28,7 +36,9 @@ namespace Liquid {
         bool look(Token::Type type, size_t ahead = 0);
 
     private:
-        std::vector<Token> tokens_;
+        std::vector<Token>& tokens_;
+        const size_t begin_;
+        size_t size_;
         size_t pos_;
 
         const Token& tokenAt(size_t position) const;
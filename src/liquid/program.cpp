@@ -0,0 +1,269 @@
+#include "program.hpp"
+#include "blockbody.hpp"
+#include "context.hpp"
+#include "for.hpp"
+#include "if.hpp"
+
+void Liquid::Program::run(Context& context, OutputSink& out) const
+{
+    struct Frame {
+        ForLoopState loop;
+        uint32_t next;
+        uint32_t end;
+    };
+    std::vector<Frame> frames;
+    const size_t size = code_.size();
+    size_t pc = 0;
+    while (pc < size) {
+        const Instruction& ins = code_[pc];
+        switch (ins.op) {
+            case Opcode::Text:
+                out.appendStatic(texts_[ins.operand]);
+                ++pc;
+                break;
+            case Opcode::Output: {
+                const Data& value = variables_[ins.operand]->evaluate(context);
+                if (value.isString()) {
+                    const Data::StringSpan text = value.stringSpan();
+                    out.append(text.data, text.size);
+                } else {
+                    out.append(value.toString());
+                }
+                ++pc;
+                break;
+            }
+            case Opcode::Render:
+                nodes_[ins.operand]->render(context, out);
+                ++pc;
+                // A break or continue inside a node rendered by the tree.
+                if (context.haveInterrupt()) {
+                    if (frames.empty()) {
+                        return;
+                    }
+                    const Frame& frame = frames.back();
+                    pc = context.pop_interrupt() == Context::Interrupt::Break ? frame.end : frame.next;
+                }
+                break;
+            case Opcode::Jump:
+                pc = ins.target;
+                break;
+            case Opcode::JumpIfFalse:
+                pc = conditions_[ins.operand]->evaluate(context) ? pc + 1 : ins.target;
+                break;
+            case Opcode::JumpIfTrue:
+                pc = conditions_[ins.operand]->evaluate(context) ? ins.target : pc + 1;
+                break;
+            case Opcode::LoopBegin: {
+                frames.emplace_back();
+                Frame& frame = frames.back();
+                if (frame.loop.begin(*loops_[ins.operand].tag, context)) {
+                    frame.next = static_cast<uint32_t>(pc + 1);
+                    frame.end = loops_[ins.operand].end;
+                    ++pc;
+                } else {
+                    frames.pop_back();
+                    pc = ins.target;
+                }
+                break;
+            }
+            case Opcode::LoopNext:
+                pc = frames.back().loop.next(context) ? pc + 1 : ins.target;
+                break;
+            case Opcode::LoopEnd:
+                frames.back().loop.end(context);
+                frames.pop_back();
+                ++pc;
+                break;
+            case Opcode::Interrupt:
+                context.push_interrupt(static_cast<Context::Interrupt>(ins.operand));
+                return;
+        }
+    }
+}
+
+size_t Liquid::Compiler::emit(Program::Opcode op, size_t operand, size_t target)
+{
+    program_.code_.push_back(Program::Instruction{op, static_cast<uint32_t>(operand), static_cast<uint32_t>(target)});
+    return program_.code_.size() - 1;
+}
+
+uint32_t Liquid::Compiler::position() const
+{
+    return static_cast<uint32_t>(program_.code_.size());
+}
+
+void Liquid::Compiler::compile(const BlockBody& body)
+{
+    body.compile(*this);
+}
+
+void Liquid::Compiler::emitText(const StringRef& text)
+{
+    if (text.isEmpty()) {
+        return;
+    }
+    program_.texts_.push_back(text);
+    emit(Program::Opcode::Text, program_.texts_.size() - 1);
+}
+
+void Liquid::Compiler::emitOutput(const Variable& variable)
+{
+    program_.variables_.push_back(&variable);
+    emit(Program::Opcode::Output, program_.variables_.size() - 1);
+}
+
+void Liquid::Compiler::emitRender(const Node& node)
+{
+    program_.nodes_.push_back(&node);
+    emit(Program::Opcode::Render, program_.nodes_.size() - 1);
+}
+
+size_t Liquid::Compiler::emitJump()
+{
+    return emit(Program::Opcode::Jump);
+}
+
+size_t Liquid::Compiler::emitJumpUnless(const Condition& condition, bool expected)
+{
+    program_.conditions_.push_back(&condition);
+    return emit(expected ? Program::Opcode::JumpIfFalse : Program::Opcode::JumpIfTrue, program_.conditions_.size() - 1);
+}
+
+void Liquid::Compiler::setTarget(size_t instruction)
+{
+    program_.code_[instruction].target = position();
+}
+
+void Liquid::Compiler::compileLoop(const ForTag& tag, const BlockBody& body, const BlockBody& elseBlock)
+{
+    program_.loops_.push_back(Program::Loop{&tag, 0});
+    const size_t loop = program_.loops_.size() - 1;
+    const size_t begin = emit(Program::Opcode::LoopBegin, loop);
+    const uint32_t next = position();
+    const size_t nextJump = emit(Program::Opcode::LoopNext, loop);
+    loops_.push_back(LoopScope{next, {}});
+    compile(body);
+    emit(Program::Opcode::Jump, 0, next);
+    
+    const uint32_t end = position();
+    program_.loops_[loop].end = end;
+    setTarget(nextJump);
+    for (const size_t jump : loops_.back().breaks) {
+        setTarget(jump);
+    }
+    loops_.pop_back();
+    emit(Program::Opcode::LoopEnd, loop);
+    const size_t skipElse = emitJump();
+    
+    // The else block runs outside the loop, a break in there belongs to an
+    // enclosing loop.
+    setTarget(begin);
+    compile(elseBlock);
+    setTarget(skipElse);
+}
+
+void Liquid::Compiler::emitBreak()
+{
+    if (loops_.empty()) {
+        emit(Program::Opcode::Interrupt, static_cast<size_t>(Context::Interrupt::Break));
+    } else {
+        loops_.back().breaks.push_back(emitJump());
+    }
+}
+
+void Liquid::Compiler::emitContinue()
+{
+    if (loops_.empty()) {
+        emit(Program::Opcode::Interrupt, static_cast<size_t>(Context::Interrupt::Continue));
+    } else {
+        emit(Program::Opcode::Jump, 0, loops_.back().next);
+    }
+}
+
+
+
+#ifdef TESTS
+
+#include "tests.hpp"
+#include "template.hpp"
+
+namespace {
+    
+    // Renders source through the tree interpreter and the compiled program.
+    void checkSameOutput(const Liquid::String& source, const Liquid::Data& data)
+    {
+        Liquid::Template tree;
+        tree.parse(source);
+        Liquid::Template compiled;
+        compiled.parse(source).compile();
+        REQUIRE(compiled.isCompiled());
+        Liquid::Data treeData = data;
+        Liquid::Data compiledData = data;
+        INFO(source.toStdString());
+        CHECK(compiled.render(compiledData) == tree.render(treeData));
+    }
+    
+}
+
+TEST_CASE("Liquid::Program") {
+    
+    Liquid::Data data(Liquid::Data::Type::Hash);
+    data.insert("name", "Steve");
+    data.insert("items", Liquid::Data::Array{1, 2, 3, 4, 5});
+    data.insert("empty", Liquid::Data::Array{});
+    data.insert("matrix", Liquid::Data::Array{Liquid::Data::Array{1, 2}, Liquid::Data::Array{3, 4}});
+    
+    SECTION("Differential") {
+        const std::vector<Liquid::String> sources = {
+            "",
+            "Hello {{ name | upcase }}!",
+            "{% if name == 'Steve' %}a{% elsif name %}b{% else %}c{% endif %}",
+            "{% if name == 'Bob' %}a{% elsif name contains 'e' %}b{% else %}c{% endif %}",
+            "{% if false %}a{% elsif false %}b{% else %}c{% endif %}{% if false %}x{% endif %}",
+            "{% unless name %}a{% elsif name %}b{% else %}c{% endunless %}{% unless false %}d{% endunless %}",
+            "{% for i in items %}{{ forloop.index }}:{{ i }}{% unless forloop.last %},{% endunless %}{% endfor %}",
+            "{% for i in items reversed limit: 3 offset: 1 %}{{ i }}{% endfor %}",
+            "{% for i in (1..4) %}{{ i }}{% else %}none{% endfor %}{% for i in empty %}{{ i }}{% else %}none{% endfor %}",
+            "{% for row in matrix %}{% for cell in row %}{{ forloop.parentloop.index }}.{{ cell }} {% endfor %}{% endfor %}",
+            "{% for i in items %}{% if i == 2 %}{% continue %}{% endif %}{% if i == 4 %}{% break %}{% endif %}{{ i }}{% endfor %}",
+            "{% for row in matrix %}{% for cell in row %}{% if cell == 2 %}{% break %}{% endif %}{{ cell }}{% endfor %}|{% endfor %}",
+            "{% for i in items %}{% capture c %}{{ i }}{% if i == 3 %}{% break %}{% endif %}x{% endcapture %}{{ c }}{% endfor %}{{ c }}",
+            "{% for i in items %}{% case i %}{% when 2 %}{% continue %}{% when 4 %}{% break %}{% endcase %}{{ i }}{% endfor %}",
+            "{% for i in empty %}{% else %}{% for j in items %}{% break %}{% endfor %}e{% endfor %}",
+            "a{% break %}b",
+            "a{% if true %}{% continue %}{% endif %}b",
+            "{% for i in items %}{% cycle 'x', 'y' %}{% increment n %}{% ifchanged %}{{ i | divided_by: 2 }}{% endifchanged %}{% endfor %}",
+            "{% assign total = 0 %}{% for i in items %}{% assign total = total | plus: i %}{% endfor %}{{ total }}",
+            "{% comment %}{{ name }}{% endcomment %}{% for i in (1..3) %}{% comment %}{% break %}{% endcomment %}{{ i }}{% endfor %}",
+        };
+        for (const auto& source : sources) {
+            checkSameOutput(source, data);
+        }
+    }
+    
+    SECTION("Instructions") {
+        Liquid::Template t;
+        t.parse("{% for i in items %}{% if i > 2 %}{% break %}{% endif %}{{ i }}{% endfor %}").compile();
+        size_t renders = 0;
+        size_t loops = 0;
+        for (const auto& ins : t.program().instructions()) {
+            if (ins.op == Liquid::Program::Opcode::Render) {
+                ++renders;
+            } else if (ins.op == Liquid::Program::Opcode::LoopBegin) {
+                ++loops;
+            }
+        }
+        CHECK(renders == 0);
+        CHECK(loops == 1);
+    }
+    
+    SECTION("Errors") {
+        Liquid::Template t;
+        t.parse("a{% for i in items %}{{ i | nosuchfilter }}{% endfor %}").compile();
+        Liquid::Data copy = data;
+        CHECK_THROWS(t.render(copy));
+    }
+    
+}
+
+#endif
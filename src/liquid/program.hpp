@@ -0,0 +1,113 @@
+#ifndef LIQUID_PROGRAM_HPP
+#define LIQUID_PROGRAM_HPP
+
+#include "string.hpp"
+#include "outputsink.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace Liquid {
+    
+    class Context;
+    class Node;
+    class BlockBody;
+    class Variable;
+    class Condition;
+    class ForTag;
+    
+    // A template compiled to a flat list of instructions. Text, output,
+    // if/unless and for tags, and break/continue are executed directly;
+    // loops are jumps, and break/continue jumps out of or back to the loop
+    // instead of interrupts that every enclosing block has to check. Any
+    // other tag is rendered by the tree interpreter as a single instruction.
+    //
+    // The program refers into the parsed template, which must outlive it.
+    class Program {
+    public:
+        enum class Opcode : uint8_t {
+            Text,           // Append texts[operand]
+            Output,         // Append the value of variables[operand]
+            Render,         // Render nodes[operand] through the tree
+            Jump,           // Continue at target
+            JumpIfFalse,    // Continue at target unless conditions[operand] holds
+            JumpIfTrue,     // Continue at target if conditions[operand] holds
+            LoopBegin,      // Start loops[operand], or continue at target if it has no items
+            LoopNext,       // Move to the next item, or continue at target after the last
+            LoopEnd,        // Finish the innermost loop
+            Interrupt,      // Push Context::Interrupt(operand) and stop
+        };
+        
+        struct Instruction {
+            Opcode op;
+            uint32_t operand;
+            uint32_t target;
+        };
+        
+        void run(Context& context, OutputSink& out) const;
+        
+        const std::vector<Instruction>& instructions() const {
+            return code_;
+        }
+        
+    private:
+        friend class Compiler;
+        
+        struct Loop {
+            const ForTag* tag;
+            uint32_t end;
+        };
+        
+        std::vector<Instruction> code_;
+        std::vector<StringRef> texts_;
+        std::vector<const Variable*> variables_;
+        std::vector<const Node*> nodes_;
+        std::vector<const Condition*> conditions_;
+        std::vector<Loop> loops_;
+    };
+    
+    // Lowers a node tree into a Program. Nodes emit their own instructions
+    // through Node::compile(), which falls back to emitRender().
+    class Compiler {
+    public:
+        explicit Compiler(Program& program)
+            : program_(program)
+        {
+        }
+        
+        void compile(const BlockBody& body);
+        
+        void emitText(const StringRef& text);
+        void emitOutput(const Variable& variable);
+        void emitRender(const Node& node);
+        
+        // Jump instructions return their index, so the target can be set
+        // with setTarget() once it has been emitted.
+        size_t emitJump();
+        
+        // Jumps unless condition evaluates to expected.
+        size_t emitJumpUnless(const Condition& condition, bool expected);
+        
+        // Makes the jump at instruction continue at the next instruction
+        // that is emitted.
+        void setTarget(size_t instruction);
+        
+        void compileLoop(const ForTag& tag, const BlockBody& body, const BlockBody& elseBlock);
+        void emitBreak();
+        void emitContinue();
+        
+    private:
+        struct LoopScope {
+            uint32_t next;
+            std::vector<size_t> breaks;
+        };
+        
+        Program& program_;
+        std::vector<LoopScope> loops_;
+        
+        size_t emit(Program::Opcode op, size_t operand = 0, size_t target = 0);
+        uint32_t position() const;
+    };
+    
+}
+
+#endif
@@ -0,0 +1,214 @@
+#include "renderer.hpp"
+#include "template.hpp"
+#include "error.hpp"
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+
+namespace Liquid {
+
+    class Renderer::Channel : public OutputSink {
+    public:
+        explicit Channel(String::size_type capacity)
+            : capacity_(capacity > 0 ? capacity : 1)
+        {
+        }
+
+        virtual void append(const String& text) override {
+            append(StringRef(&text));
+        }
+
+        virtual void append(const StringRef& text) override {
+            String::size_type pos = 0;
+            const auto size = text.size();
+            while (pos < size) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                spaceAvailable_.wait(lock, [this] {
+                    return cancelled_ || pending() < capacity_;
+                });
+                if (cancelled_) {
+                    throw render_cancelled();
+                }
+                const auto count = std::min(size - pos, capacity_ - pending());
+                text.mid(pos, count).appendTo(buffer_);
+                pos += count;
+                dataAvailable_.notify_one();
+            }
+        }
+
+        virtual void append(const String::value_type* text, String::size_type size) override {
+            append(StringRef(text, size));
+        }
+
+        String read(String::size_type chunkSize) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            dataAvailable_.wait(lock, [this] {
+                return done_ || pending() > 0;
+            });
+            if (pending() == 0 && error_) {
+                const std::exception_ptr error = error_;
+                error_ = nullptr;
+                std::rethrow_exception(error);
+            }
+            const auto count = std::min(chunkSize, pending());
+            String chunk = buffer_.mid(readPos_, count);
+            readPos_ += count;
+            // Drop what was read once nothing is left after it, or once it
+            // is at least as large as what can be pending, so each
+            // character is moved at most once more.
+            if (readPos_ == buffer_.size() || readPos_ >= capacity_) {
+                buffer_.replace(0, readPos_, String());
+                readPos_ = 0;
+            }
+            spaceAvailable_.notify_one();
+            return chunk;
+        }
+
+        bool atEnd() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return done_ && pending() == 0 && !error_;
+        }
+
+        void finish(const std::exception_ptr& error) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+            error_ = error;
+            dataAvailable_.notify_one();
+        }
+
+        void cancel() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cancelled_ = true;
+            spaceAvailable_.notify_one();
+        }
+
+    private:
+        String::size_type pending() const {
+            return buffer_.size() - readPos_;
+        }
+
+        const String::size_type capacity_;
+        mutable std::mutex mutex_;
+        std::condition_variable spaceAvailable_;
+        std::condition_variable dataAvailable_;
+        // Characters before readPos_ have been read.
+        String buffer_;
+        String::size_type readPos_ = 0;
+        bool done_ = false;
+        bool cancelled_ = false;
+        std::exception_ptr error_;
+    };
+
+}
+
+Liquid::Renderer::Renderer(const Template& tmpl, const Data& data, String::size_type bufferSize)
+    : channel_(std::make_shared<Channel>(bufferSize))
+{
+    const std::shared_ptr<Channel> channel = channel_;
+    thread_ = std::thread([channel, &tmpl, &data] {
+        std::exception_ptr error;
+        try {
+            tmpl.render(data, *channel);
+        } catch (const render_cancelled&) {
+        } catch (...) {
+            error = std::current_exception();
+        }
+        channel->finish(error);
+    });
+}
+
+Liquid::Renderer::Renderer(Renderer&& other)
+    : channel_(std::move(other.channel_))
+    , thread_(std::move(other.thread_))
+{
+}
+
+Liquid::Renderer::~Renderer()
+{
+    if (channel_) {
+        channel_->cancel();
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+Liquid::String Liquid::Renderer::next(String::size_type chunkSize)
+{
+    if (!channel_) {
+        return String();
+    }
+    return channel_->read(chunkSize);
+}
+
+bool Liquid::Renderer::atEnd() const
+{
+    return !channel_ || channel_->atEnd();
+}
+
+
+
+#ifdef TESTS
+
+#include "tests.hpp"
+#include "error.hpp"
+
+TEST_CASE("Liquid::Renderer") {
+
+    SECTION("Chunks") {
+        Liquid::Template t;
+        t.parse("{% for i in (1..1000) %}{% if i > 1 %},{% endif %}{{ i }}{% endfor %}");
+        Liquid::Data data1(Liquid::Data::Type::Hash);
+        const Liquid::String expected = t.render(data1);
+        Liquid::Data data2(Liquid::Data::Type::Hash);
+        Liquid::Renderer renderer = t.renderer(data2, 16);
+        Liquid::String output;
+        for (;;) {
+            const Liquid::String chunk = renderer.next(7);
+            if (chunk.isEmpty()) {
+                break;
+            }
+            CHECK(chunk.size() <= 7);
+            output += chunk;
+        }
+        CHECK(renderer.atEnd());
+        CHECK(output == expected);
+    }
+
+    SECTION("Error") {
+        Liquid::Template t;
+        t.parse("Hello {{ 'world' | nosuchfilter }}");
+        Liquid::Data data(Liquid::Data::Type::Hash);
+        Liquid::Renderer renderer = t.renderer(data);
+        CHECK(renderer.next(100) == "Hello ");
+        CHECK_THROWS_AS(renderer.next(100), Liquid::syntax_error);
+    }
+
+    SECTION("Abandoned") {
+        Liquid::Template t;
+        t.parse("{% for i in (1..100000) %}{{ i }}{% endfor %}");
+        Liquid::Data data(Liquid::Data::Type::Hash);
+        Liquid::Renderer renderer = t.renderer(data, 8);
+        const Liquid::String chunk = renderer.next(3);
+        CHECK_FALSE(chunk.isEmpty());
+        CHECK(chunk.size() <= 3);
+        CHECK_FALSE(renderer.atEnd());
+    }
+
+    SECTION("SmallReads") {
+        Liquid::Template t;
+        t.parse("{% for i in (1..2000) %}{{ i }},{% endfor %}");
+        Liquid::Data data1(Liquid::Data::Type::Hash);
+        const Liquid::String expected = t.render(data1);
+        Liquid::Data data2(Liquid::Data::Type::Hash);
+        Liquid::Renderer renderer = t.renderer(data2, 1000);
+        Liquid::String output;
+        for (Liquid::String chunk = renderer.next(1); !chunk.isEmpty(); chunk = renderer.next(1)) {
+            output += chunk;
+        }
+        CHECK(output == expected);
+    }
+
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef LIQUID_RENDERER_HPP
+#define LIQUID_RENDERER_HPP
+
+#include "string.hpp"
+#include <memory>
+#include <thread>
+
+namespace Liquid {
+
+    class Template;
+    class Data;
+
+    // Pulls the output of a render incrementally. The render runs on a
+    // producer thread which blocks whenever bufferSize characters are waiting
+    // to be read, so memory stays bounded no matter how large the output is
+    // and the render suspends wherever it happens to be (e.g. mid-loop).
+    // The template and data must outlive the renderer, and the data must not
+    // be modified until it is destroyed.
+    //
+    // Destroying the renderer before the render completes stops it by
+    // throwing render_cancelled (see error.hpp) from the next write to the
+    // output, so filters and drops that catch exceptions must let that one
+    // through.
+    class Renderer {
+    public:
+        static const String::size_type kDefaultBufferSize = 64 * 1024;
+
+        Renderer(const Template& tmpl, const Data& data, String::size_type bufferSize = kDefaultBufferSize);
+        Renderer(Renderer&& other);
+        ~Renderer();
+
+        Renderer(const Renderer&) = delete;
+        Renderer& operator=(const Renderer&) = delete;
+
+        // Returns up to chunkSize characters of output, blocking until some
+        // are available. Returns an empty string once the render is complete.
+        // Errors raised while rendering are rethrown here.
+        String next(String::size_type chunkSize);
+
+        bool atEnd() const;
+
+    private:
+        class Channel;
+
+        std::shared_ptr<Channel> channel_;
+        std::thread thread_;
+    };
+
+}
+
+#endif
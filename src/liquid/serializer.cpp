@@ -0,0 +1,209 @@
+#include "serializer.hpp"
+#include "error.hpp"
+#include <cstring>
+
+void Liquid::BinaryWriter::writeSize(uint64_t value)
+{
+    while (value >= 0x80) {
+        writeByte(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    writeByte(static_cast<uint8_t>(value));
+}
+
+void Liquid::BinaryWriter::writeInt(int64_t value)
+{
+    // Zigzag encoding keeps small negative numbers small.
+    const uint64_t bits = static_cast<uint64_t>(value);
+    writeSize((bits << 1) ^ (value < 0 ? ~static_cast<uint64_t>(0) : 0));
+}
+
+void Liquid::BinaryWriter::writeDouble(double value)
+{
+    char bytes[sizeof(double)];
+    memcpy(bytes, &value, sizeof(double));
+    bytes_.append(bytes, sizeof(double));
+}
+
+void Liquid::BinaryWriter::writeString(const String& value)
+{
+    writeSize(value.size());
+    bytes_.append(reinterpret_cast<const char*>(value.data()), value.size() * sizeof(String::value_type));
+}
+
+void Liquid::BinaryWriter::writeStringRef(const StringRef& value)
+{
+    if (value.isNull()) {
+        writeSize(0);
+        return;
+    }
+    if (!value.hasSameSource(source_)) {
+        throw serialization_error("Cannot serialize text that is not part of the template source");
+    }
+    writeSize(value.position() + 1);
+    writeSize(value.size());
+}
+
+void Liquid::BinaryWriter::writeData(const Data& value)
+{
+    writeByte(static_cast<uint8_t>(value.type()));
+    switch (value.type()) {
+        case Data::Type::String:
+            writeString(value.toString());
+            break;
+        case Data::Type::NumberInt:
+            writeInt(value.toInt());
+            break;
+        case Data::Type::NumberFloat:
+            writeDouble(value.toFloat());
+            break;
+        case Data::Type::BooleanTrue:
+        case Data::Type::BooleanFalse:
+        case Data::Type::Nil:
+            break;
+        default:
+            throw serialization_error("Cannot serialize hashes, arrays or drops");
+    }
+}
+
+void Liquid::BinaryReader::require(size_t count) const
+{
+    if (count > size_ - pos_) {
+        throw serialization_error("Unexpected end of serialized template");
+    }
+}
+
+uint64_t Liquid::BinaryReader::readSize()
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        const uint8_t byte = readByte();
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw serialization_error("Invalid number in serialized template");
+}
+
+int64_t Liquid::BinaryReader::readInt()
+{
+    const uint64_t bits = readSize();
+    return static_cast<int64_t>((bits >> 1) ^ (~(bits & 1) + 1));
+}
+
+double Liquid::BinaryReader::readDouble()
+{
+    require(sizeof(double));
+    double value;
+    memcpy(&value, data_ + pos_, sizeof(double));
+    pos_ += sizeof(double);
+    return value;
+}
+
+Liquid::String Liquid::BinaryReader::readString()
+{
+    const uint64_t size = readSize();
+    if (size > (size_ - pos_) / sizeof(String::value_type)) {
+        throw serialization_error("Unexpected end of serialized template");
+    }
+    const size_t bytes = static_cast<size_t>(size) * sizeof(String::value_type);
+    String value;
+    if (size > 0) {
+        std::vector<String::value_type> chars(static_cast<size_t>(size));
+        memcpy(chars.data(), data_ + pos_, bytes);
+        value = String(chars.data(), static_cast<String::size_type>(size));
+    }
+    pos_ += bytes;
+    return value;
+}
+
+Liquid::StringRef Liquid::BinaryReader::readStringRef()
+{
+    const uint64_t position = readSize();
+    if (position == 0) {
+        return StringRef();
+    }
+    const uint64_t size = readSize();
+    if (position - 1 > source_.size() || size > source_.size() - (position - 1)) {
+        throw serialization_error("Invalid text reference in serialized template");
+    }
+    return StringRef(&source_, static_cast<String::size_type>(position - 1), static_cast<String::size_type>(size));
+}
+
+Liquid::Data Liquid::BinaryReader::readData()
+{
+    const Data::Type type = static_cast<Data::Type>(readByte());
+    switch (type) {
+        case Data::Type::String:
+            return readString();
+        case Data::Type::NumberInt:
+            return static_cast<int>(readInt());
+        case Data::Type::NumberFloat:
+            return readDouble();
+        case Data::Type::BooleanTrue:
+            return true;
+        case Data::Type::BooleanFalse:
+            return false;
+        case Data::Type::Nil:
+            return Data();
+        default:
+            throw serialization_error("Invalid value in serialized template");
+    }
+}
+
+
+
+#ifdef TESTS
+
+#include "tests.hpp"
+
+TEST_CASE("Liquid::BinaryWriter") {
+    
+    SECTION("RoundTrip") {
+        const Liquid::String source = "Hello world";
+        Liquid::BinaryWriter writer(source);
+        writer.writeSize(0);
+        writer.writeSize(300);
+        writer.writeInt(-1);
+        writer.writeInt(-1000000);
+        writer.writeInt(123456);
+        writer.writeDouble(2.5);
+        writer.writeString("abc");
+        writer.writeStringRef(Liquid::StringRef(&source, 6, 5));
+        writer.writeStringRef(Liquid::StringRef());
+        writer.writeData("x");
+        writer.writeData(42);
+        writer.writeData(nullptr);
+        writer.writeBool(true);
+        CHECK(writer.bytes().size() < 40);
+        
+        const Liquid::TagLoaderHash loaders;
+        Liquid::BinaryReader reader(writer.bytes().data(), writer.bytes().size(), source, loaders);
+        CHECK(reader.readSize() == 0);
+        CHECK(reader.readSize() == 300);
+        CHECK(reader.readInt() == -1);
+        CHECK(reader.readInt() == -1000000);
+        CHECK(reader.readInt() == 123456);
+        CHECK(reader.readDouble() == 2.5);
+        CHECK(reader.readString() == "abc");
+        CHECK(reader.readStringRef() == "world");
+        CHECK(reader.readStringRef().isNull());
+        CHECK(reader.readData() == Liquid::Data("x"));
+        CHECK(reader.readData() == Liquid::Data(42));
+        CHECK(reader.readData().isNil());
+        CHECK(reader.readBool());
+        CHECK(reader.atEnd());
+        CHECK_THROWS_AS(reader.readByte(), Liquid::serialization_error);
+    }
+    
+    SECTION("ForeignText") {
+        const Liquid::String source = "Hello";
+        const Liquid::String other = "Hello";
+        Liquid::BinaryWriter writer(source);
+        CHECK_THROWS_AS(writer.writeStringRef(Liquid::StringRef(&other)), Liquid::serialization_error);
+    }
+    
+}
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef LIQUID_SERIALIZER_HPP
+#define LIQUID_SERIALIZER_HPP
+
+#include "data.hpp"
+#include "string.hpp"
+#include "tag.hpp"
+#include <cstdint>
+#include <string>
+
+namespace Liquid {
+    
+    // Writes the binary form of a parsed template. Integers are stored as
+    // variable-length quantities, and every StringRef as a position in the
+    // template source, which is stored only once.
+    class BinaryWriter {
+    public:
+        explicit BinaryWriter(const StringRef& source)
+            : source_(source)
+        {
+        }
+        
+        explicit BinaryWriter(const String& source)
+            : source_(&source)
+        {
+        }
+        
+        explicit BinaryWriter(String&& source) = delete;
+        
+        void writeByte(uint8_t value) {
+            bytes_.push_back(static_cast<char>(value));
+        }
+        
+        void writeBool(bool value) {
+            writeByte(value ? 1 : 0);
+        }
+        
+        void writeSize(uint64_t value);
+        void writeInt(int64_t value);
+        void writeDouble(double value);
+        void writeString(const String& value);
+        void writeStringRef(const StringRef& value);
+        
+        // Only the scalar types that appear in parsed templates.
+        void writeData(const Data& value);
+        
+        const std::string& bytes() const {
+            return bytes_;
+        }
+        
+    private:
+        const StringRef source_;
+        std::string bytes_;
+    };
+    
+    class BinaryReader {
+    public:
+        // StringRefs that are read refer into source, which must outlive
+        // whatever is loaded.
+        BinaryReader(const char* data, size_t size, const String& source, const TagLoaderHash& tagLoaders)
+            : data_(data)
+            , size_(size)
+            , pos_(0)
+            , source_(source)
+            , tagLoaders_(tagLoaders)
+        {
+        }
+        
+        uint8_t readByte() {
+            require(1);
+            return static_cast<uint8_t>(data_[pos_++]);
+        }
+        
+        bool readBool() {
+            return readByte() != 0;
+        }
+        
+        uint64_t readSize();
+        int64_t readInt();
+        double readDouble();
+        String readString();
+        StringRef readStringRef();
+        Data readData();
+        
+        const TagLoaderHash& tagLoaders() const {
+            return tagLoaders_;
+        }
+        
+        bool atEnd() const {
+            return pos_ == size_;
+        }
+        
+    private:
+        const char* data_;
+        const size_t size_;
+        size_t pos_;
+        const String& source_;
+        const TagLoaderHash& tagLoaders_;
+        
+        void require(size_t count) const;
+    };
+    
+}
+
+#endif
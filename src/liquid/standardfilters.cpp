@@ -4,17 +4,33 @@
 #include "template.hpp"
 #include "error.hpp"
 #include <cerrno>
+#include <cmath>
+#include <cstring>
 #include <ctime>
 
 namespace Liquid { namespace StandardFilters {
 
+// Appends value as text, without copying it first if it is a string.
+static void appendText(String& text, const Data& value)
+{
+    if (value.isString()) {
+        const Data::StringSpan span = value.stringSpan();
+        text.append(span.data, span.size);
+    } else {
+        text += value.toString();
+    }
+}
+
 Data append(const Data& input, const std::vector<Data>& args)
 {
-    Data value = input;
+    if (args.empty()) {
+        return input;
+    }
+    String result = input.toString();
     for (const auto& arg : args) {
-        value = value.toString() + arg.toString();
+        appendText(result, arg);
     }
-    return value;
+    return result;
 }
 
 Data prepend(const Data& input, const std::vector<Data>& args)
@@ -22,7 +38,9 @@ Data prepend(const Data& input, const std::vector<Data>& args)
     if (args.size() != 1) {
         throw syntax_error(String("prepend only takes one argument, but was passed %1.").arg(args.size()));
     }
-    return args[0].toString() + input.toString();
+    String result = args[0].toString();
+    appendText(result, input);
+    return result;
 }
 
 Data downcase(const Data& input, const std::vector<Data>& args)
@@ -465,7 +483,7 @@ Data join(const Data& input, const std::vector<Data>& args)
     const int inputSize = static_cast<int>(input.size());
     const auto joiner = args[0].toString();
     for (int i = 0; i < inputSize; ++i) {
-        result += input.at(i).toString();
+        appendText(result, input.at(i));
         if (i < (inputSize - 1)) {
             result += joiner;
         }
@@ -798,50 +816,51 @@ Data date(const Data& input, const std::vector<Data>& args)
 
 void registerFilters(Template& tmpl)
 {
-    tmpl.registerFilter("append", append);
-    tmpl.registerFilter("prepend", prepend);
-    tmpl.registerFilter("downcase", downcase);
-    tmpl.registerFilter("upcase", upcase);
-    tmpl.registerFilter("capitalize", capitalize);
-    tmpl.registerFilter("strip", strip);
-    tmpl.registerFilter("rstrip", rstrip);
-    tmpl.registerFilter("lstrip", lstrip);
-    tmpl.registerFilter("strip_newlines", strip_newlines);
-    tmpl.registerFilter("newline_to_br", newline_to_br);
-    tmpl.registerFilter("escape", escape);
-    tmpl.registerFilter("escape_once", escape_once);
-    tmpl.registerFilter("url_encode", url_encode);
-    tmpl.registerFilter("url_decode", url_decode);
-    tmpl.registerFilter("strip_html", strip_html);
-    tmpl.registerFilter("truncate", truncate);
-    tmpl.registerFilter("truncatewords", truncatewords);
-    tmpl.registerFilter("plus", plus);
-    tmpl.registerFilter("minus", minus);
-    tmpl.registerFilter("times", times);
-    tmpl.registerFilter("divided_by", divided_by);
-    tmpl.registerFilter("abs", abs);
-    tmpl.registerFilter("ceil", ceil);
-    tmpl.registerFilter("floor", floor);
-    tmpl.registerFilter("round", round);
-    tmpl.registerFilter("modulo", modulo);
-    tmpl.registerFilter("split", split);
-    tmpl.registerFilter("join", join);
-    tmpl.registerFilter("uniq", uniq);
-    tmpl.registerFilter("size", size);
-    tmpl.registerFilter("first", first);
-    tmpl.registerFilter("last", last);
-    tmpl.registerFilter("default", def);
-    tmpl.registerFilter("replace", replace);
-    tmpl.registerFilter("replace_first", replace_first);
-    tmpl.registerFilter("remove", remove);
-    tmpl.registerFilter("remove_first", remove_first);
-    tmpl.registerFilter("slice", slice);
-    tmpl.registerFilter("reverse", reverse);
-    tmpl.registerFilter("compact", compact);
-    tmpl.registerFilter("map", map);
-    tmpl.registerFilter("concat", concat);
-    tmpl.registerFilter("sort", sort);
-    tmpl.registerFilter("sort_natural", sort_natural);
+    tmpl.registerFilter("append", append, true);
+    tmpl.registerFilter("prepend", prepend, true);
+    tmpl.registerFilter("downcase", downcase, true);
+    tmpl.registerFilter("upcase", upcase, true);
+    tmpl.registerFilter("capitalize", capitalize, true);
+    tmpl.registerFilter("strip", strip, true);
+    tmpl.registerFilter("rstrip", rstrip, true);
+    tmpl.registerFilter("lstrip", lstrip, true);
+    tmpl.registerFilter("strip_newlines", strip_newlines, true);
+    tmpl.registerFilter("newline_to_br", newline_to_br, true);
+    tmpl.registerFilter("escape", escape, true);
+    tmpl.registerFilter("escape_once", escape_once, true);
+    tmpl.registerFilter("url_encode", url_encode, true);
+    tmpl.registerFilter("url_decode", url_decode, true);
+    tmpl.registerFilter("strip_html", strip_html, true);
+    tmpl.registerFilter("truncate", truncate, true);
+    tmpl.registerFilter("truncatewords", truncatewords, true);
+    tmpl.registerFilter("plus", plus, true);
+    tmpl.registerFilter("minus", minus, true);
+    tmpl.registerFilter("times", times, true);
+    tmpl.registerFilter("divided_by", divided_by, true);
+    tmpl.registerFilter("abs", abs, true);
+    tmpl.registerFilter("ceil", ceil, true);
+    tmpl.registerFilter("floor", floor, true);
+    tmpl.registerFilter("round", round, true);
+    tmpl.registerFilter("modulo", modulo, true);
+    tmpl.registerFilter("split", split, true);
+    tmpl.registerFilter("join", join, true);
+    tmpl.registerFilter("uniq", uniq, true);
+    tmpl.registerFilter("size", size, true);
+    tmpl.registerFilter("first", first, true);
+    tmpl.registerFilter("last", last, true);
+    tmpl.registerFilter("default", def, true);
+    tmpl.registerFilter("replace", replace, true);
+    tmpl.registerFilter("replace_first", replace_first, true);
+    tmpl.registerFilter("remove", remove, true);
+    tmpl.registerFilter("remove_first", remove_first, true);
+    tmpl.registerFilter("slice", slice, true);
+    tmpl.registerFilter("reverse", reverse, true);
+    tmpl.registerFilter("compact", compact, true);
+    tmpl.registerFilter("map", map, true);
+    tmpl.registerFilter("concat", concat, true);
+    tmpl.registerFilter("sort", sort, true);
+    tmpl.registerFilter("sort_natural", sort_natural, true);
+    // Not pure, "now" and "today" depend on when the template is rendered.
     tmpl.registerFilter("date", date);
 }
 
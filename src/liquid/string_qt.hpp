@@ -16,6 +16,7 @@
 #endif
 #include <unordered_map>
 #include <vector>
+#include "flathashmap.hpp"
 
 namespace Liquid {
 
@@ -35,11 +36,18 @@ namespace Liquid {
         String(const std::string& str) : String(str.c_str()) {}
         String(const base& str) : s_(str) {}
         String(value_type ch) : s_(1, ch) {}
+        String(const value_type* ptr, size_type len) : s_(reinterpret_cast<const QChar*>(ptr), static_cast<int>(len)) {}
+        String(const String& other) : s_(other.s_) {}
+        String(String&& other) noexcept : s_(std::move(other.s_)) {}
         
         size_type size() const {
             return s_.size();
         }
         
+        void reserve(size_type size) {
+            s_.reserve(size);
+        }
+        
         bool isEmpty() const {
             return s_.isEmpty();
         }
@@ -55,6 +63,13 @@ namespace Liquid {
             return *this;
         }
         
+        String& operator=(String&& other) noexcept {
+            if (&other != this) {
+                s_ = std::move(other.s_);
+            }
+            return *this;
+        }
+        
         bool operator==(const String& other) const {
             return s_ == other.s_;
         }
@@ -77,10 +92,24 @@ namespace Liquid {
             return *this;
         }
         
+        String& append(const String& str, size_type pos, size_type len) {
+            s_.append(str.s_.midRef(pos, len));
+            return *this;
+        }
+        
+        String& append(const value_type* ptr, size_type len) {
+            s_.append(reinterpret_cast<const QChar*>(ptr), static_cast<int>(len));
+            return *this;
+        }
+        
         const base& raw() const {
             return s_;
         }
         
+        const value_type* data() const {
+            return reinterpret_cast<const value_type*>(s_.constData());
+        }
+        
         String arg(const String& arg) const {
             for (int i = 0; i <= 99; ++i) {
                 const auto marker = String("%" + std::to_string(i));
@@ -104,6 +133,10 @@ namespace Liquid {
             return std::string{bytes.constData()};
         }
         
+        static String fromUtf8(const char* data, size_type size) {
+            return QString::fromUtf8(data, static_cast<int>(size));
+        }
+        
         String toLower() const {
             return s_.toLower();
         }
@@ -162,8 +195,9 @@ namespace Liquid {
         }
     };
     
+    // Iterates in insertion order. Inserting may move the values.
     template <typename T>
-    using StringKeyUnorderedMap = std::unordered_map<String, T, QStringHash>;
+    using StringKeyUnorderedMap = FlatHashMap<String, T, QStringHash>;
 
     inline std::ostream& operator << (std::ostream& os, const String& value) {
         os << value.toStdString();
@@ -9,7 +9,11 @@
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include "flathashmap.hpp"
 #include <iostream>
+#ifndef _WIN32
+#include <strings.h>
+#endif
 
 namespace Liquid {
 
@@ -28,11 +32,18 @@ namespace Liquid {
         String(const value_type* ptr) : s_(ptr) {}
         String(const base& str) : s_(str) {}
         String(value_type ch) : s_(1, ch) {}
+        String(const value_type* ptr, size_type len) : s_(ptr, len) {}
+        String(const String& other) : s_(other.s_) {}
+        String(String&& other) noexcept : s_(std::move(other.s_)) {}
         
         size_type size() const {
             return s_.size();
         }
         
+        void reserve(size_type size) {
+            s_.reserve(size);
+        }
+        
         bool isEmpty() const {
             return s_.empty();
         }
@@ -48,6 +59,13 @@ namespace Liquid {
             return *this;
         }
         
+        String& operator=(String&& other) noexcept {
+            if (&other != this) {
+                s_ = std::move(other.s_);
+            }
+            return *this;
+        }
+        
         bool operator==(const String& other) const {
             return s_ == other.s_;
         }
@@ -70,10 +88,24 @@ namespace Liquid {
             return *this;
         }
         
+        String& append(const String& str, size_type pos, size_type len) {
+            s_.append(str.s_, pos, len);
+            return *this;
+        }
+        
+        String& append(const value_type* ptr, size_type len) {
+            s_.append(ptr, len);
+            return *this;
+        }
+        
         const base& raw() const {
             return s_;
         }
         
+        const value_type* data() const {
+            return s_.data();
+        }
+        
         String arg(const String& arg) const {
             for (int i = 0; i <= 99; ++i) {
                 const auto marker = String("%" + std::to_string(i));
@@ -96,6 +128,10 @@ namespace Liquid {
             return s_;
         }
         
+        static String fromUtf8(const char* data, size_type size) {
+            return String(data, size);
+        }
+        
         String toLower() const {
             String s;
             const auto sz = size();
@@ -202,8 +238,9 @@ namespace Liquid {
         }
     };
     
+    // Iterates in insertion order. Inserting may move the values.
     template <typename T>
-    using StringKeyUnorderedMap = std::unordered_map<String, T, StringHash>;
+    using StringKeyUnorderedMap = FlatHashMap<String, T, StringHash>;
 
     inline std::ostream& operator << (std::ostream& os, const String& value) {
         os << value.toStdString();
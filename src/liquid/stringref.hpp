@@ -1,6 +1,10 @@
 #ifndef LIQUID_STRINGREF_HPP
 #define LIQUID_STRINGREF_HPP
 
+#include "stringutils.hpp"
+#include <stdexcept>
+#include <cstddef>
+
 namespace Liquid {
 
     class StringRef {
@@ -11,6 +15,7 @@ namespace Liquid {
         
         StringRef()
             : s_(nullptr)
+            , text_(nullptr)
             , pos_(0)
             , len_(0)
         {
@@ -18,6 +23,7 @@ namespace Liquid {
         
         explicit StringRef(const String* str)
             : s_(str)
+            , text_(nullptr)
             , pos_(0)
             , len_(str->size())
         {
@@ -25,25 +31,75 @@ namespace Liquid {
         
         explicit StringRef(const String* str, size_type position, size_type length)
             : s_(str)
+            , text_(nullptr)
             , pos_(position)
             , len_(length)
         {
         }
+        
+        // Refers to text that is not in a String, e.g. in a mapped file,
+        // which must outlive the reference and every one made from it.
+        StringRef(const value_type* text, size_type length)
+            : s_(nullptr)
+            , text_(text)
+            , pos_(0)
+            , len_(length)
+        {
+        }
+        
+        StringRef(const StringRef& other)
+            : s_(other.s_)
+            , text_(other.text_)
+            , pos_(other.pos_)
+            , len_(other.len_)
+        {
+        }
 
         size_type size() const {
             return len_;
         }
         
+        // The string this refers into, or null for text outside a String,
+        // and where in it.
+        const String* string() const {
+            return s_;
+        }
+        
+        size_type position() const {
+            return pos_;
+        }
+        
+        // Whether both refer into the same String or the same outside text,
+        // so that their positions are comparable.
+        bool hasSameSource(const StringRef& other) const {
+            return s_ == other.s_ && text_ == other.text_;
+        }
+        
+        // Moves the reference by delta characters if it refers into source,
+        // e.g. after text was inserted or removed in front of it.
+        void shift(const String* source, std::ptrdiff_t delta) {
+            if (s_ == source) {
+                pos_ = static_cast<size_type>(static_cast<std::ptrdiff_t>(pos_) + delta);
+            }
+        }
+        
         bool isNull() const {
-            return s_ == nullptr;
+            return s_ == nullptr && text_ == nullptr;
         }
         
         bool isEmpty() const {
             return len_ == 0;
         }
         
+        const value_type* data() const {
+            if (s_) {
+                return s_->data() + pos_;
+            }
+            return text_ ? text_ + pos_ : nullptr;
+        }
+        
         value_type at(size_type pos) const {
-            return s_->at(pos_ + pos);
+            return s_ ? s_->at(pos_ + pos) : text_[pos_ + pos];
         }
         
         StringRef mid(size_type pos, size_type num = static_cast<size_type>(-1)) const {
@@ -52,19 +108,22 @@ namespace Liquid {
                 return {};
             }
             const size_type len = ((num == static_cast<size_type>(-1)) || (sz < num)) ? (sz - pos) : num;
-            return StringRef(s_, pos_ + pos, len);
+            return StringRef(s_, text_, pos_ + pos, len);
         }
         
         StringRef left(size_type num) const {
             if (num >= size()) {
-                return StringRef(s_, pos_, len_);
+                return *this;
             }
-            return StringRef(s_, pos_, num);
+            return StringRef(s_, text_, pos_, num);
         }
         
         size_type indexOf(const String& str, size_type from = 0) const {
+            if (str.size() > size()) {
+                return static_cast<size_type >(-1);
+            }
             const auto sz = size() - str.size();
-            for (size_type i = from; i < sz; ++i) {
+            for (size_type i = from; i <= sz; ++i) {
                 if (mid(i, str.size()) == str) {
                     return i;
                 }
@@ -73,15 +132,24 @@ namespace Liquid {
         }
         
         String toString() const {
-            if (isNull()) {
-                return String();
+            if (s_) {
+                return s_->mid(pos_, len_);
+            }
+            return text_ ? String(text_ + pos_, len_) : String();
+        }
+        
+        void appendTo(String& str) const {
+            if (s_) {
+                str.append(*s_, pos_, len_);
+            } else if (text_) {
+                str.append(text_ + pos_, len_);
             }
-            return s_->mid(pos_, len_);
         }
         
         StringRef& operator=(const StringRef& other) {
             if (&other != this) {
                 s_ = other.s_;
+                text_ = other.text_;
                 pos_ = other.pos_;
                 len_ = other.len_;
             }
@@ -109,16 +177,37 @@ namespace Liquid {
             return !operator==(StringRef{&other});
         }
         
+        // See parseInt() and parseDouble(). Throw std::invalid_argument if
+        // the text is not a number.
         int toInt() const {
-            return std::stoi(toString().toStdString());
+            int result;
+            if (isNull() || !parseInt(data(), data() + len_, result)) {
+                throw std::invalid_argument("Invalid integer");
+            }
+            return result;
         }
         
         double toDouble() const {
-            return std::stod(toString().toStdString());
+            double result;
+            if (isNull() || !parseDouble(data(), data() + len_, result)) {
+                throw std::invalid_argument("Invalid number");
+            }
+            return result;
         }
         
     private:
+        StringRef(const String* str, const value_type* text, size_type position, size_type length)
+            : s_(str)
+            , text_(text)
+            , pos_(position)
+            , len_(length)
+        {
+        }
+        
+        // Either s_ or text_ is set, unless the reference is null. Positions
+        // are from the start of either.
         const String *s_;
+        const value_type* text_;
         size_type pos_;
         size_type len_;
     };
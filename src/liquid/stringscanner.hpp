@@ -66,19 +66,20 @@ namespace Liquid {
         }
         
         StringRef peekInt() {
-            StringRef::size_type count = 0;
             const auto size = input_.size();
-            for (StringRef::size_type i = pos_ ; i < size; ++i, ++count) {
-                const auto ch = input_.at(i);
-                if (count == 0) {
-                    if (!(isDigit(ch) || (ch == '-' && i < (size - 1) && isDigit(input_.at(i + 1))))) {
-                        return StringRef();
-                    }
-                } else if (!isDigit(ch)) {
-                    break;
-                }
+            const auto data = input_.data();
+            auto pos = pos_;
+            if (pos < size && data[pos] == '-') {
+                ++pos;
+            }
+            const auto digitsPos = pos;
+            while (pos < size && isDigit(data[pos])) {
+                ++pos;
             }
-            return input_.mid(pos_, count);
+            if (pos == digitsPos) {
+                return StringRef();
+            }
+            return input_.mid(pos_, pos - pos_);
         }
 
         StringRef scanInt() {
@@ -95,21 +96,17 @@ namespace Liquid {
                 return intStr;
             }
             const auto size = input_.size();
-            auto count = intStr.size();
-            auto pos = pos_ + count;
-            if (pos > (size - 1) || input_.at(pos) != '.') {
+            const auto data = input_.data();
+            auto pos = pos_ + intStr.size();
+            if (pos >= size || data[pos] != '.') {
                 return StringRef();
             }
             ++pos;
-            ++count;
-            for (StringRef::size_type i = pos ; i < size; ++i, ++count) {
-                const auto ch = input_.at(i);
-                if (!isDigit(ch)) {
-                    break;
-                }
+            while (pos < size && isDigit(data[pos])) {
+                ++pos;
             }
-            const StringRef result = input_.mid(pos_, count);
-            pos_ += count;
+            const StringRef result = input_.mid(pos_, pos - pos_);
+            pos_ = pos;
             return result;
         }
         
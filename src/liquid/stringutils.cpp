@@ -52,6 +52,36 @@ Liquid::String Liquid::doubleToString(double value, int precision)
     return str;
 }
 
+bool Liquid::parseDoubleSlow(const std::string& text, double& result)
+{
+    std::istringstream stream(text);
+    stream.imbue(std::locale::classic());
+    double value;
+    stream >> value;
+    if (stream.fail() || !stream.eof()) {
+        return false;
+    }
+    result = value;
+    return true;
+}
+
+uint64_t Liquid::hash64(const String& input)
+{
+    return hash64(StringRef(&input));
+}
+
+uint64_t Liquid::hash64(const StringRef& input)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(input.data());
+    const size_t byteCount = input.size() * sizeof(String::value_type);
+    uint64_t result = 14695981039346656037ULL;
+    for (size_t i = 0; i < byteCount; ++i) {
+        result ^= bytes[i];
+        result *= 1099511628211ULL;
+    }
+    return result;
+}
+
 
 #ifdef TESTS
 
@@ -92,6 +122,49 @@ TEST_CASE("Liquid::StringUtils") {
         input = " \n  \r \t\t\t   ";
         CHECK(tostd(Liquid::ltrim(Liquid::StringRef{&input})) == "");
     }
+    
+    SECTION("parseInt") {
+        const auto parse = [](const std::string& text, int& result) {
+            return Liquid::parseInt(text.data(), text.data() + text.size(), result);
+        };
+        int result = 0;
+        CHECK(parse("0", result));
+        CHECK(result == 0);
+        CHECK(parse("-32", result));
+        CHECK(result == -32);
+        CHECK(parse("2147483647", result));
+        CHECK(result == 2147483647);
+        CHECK(parse("-2147483648", result));
+        CHECK(result == -2147483647 - 1);
+        CHECK_FALSE(parse("2147483648", result));
+        CHECK_FALSE(parse("99999999999999999999", result));
+        CHECK_FALSE(parse("", result));
+        CHECK_FALSE(parse("-", result));
+        CHECK_FALSE(parse("1.5", result));
+        CHECK_FALSE(parse(" 1", result));
+    }
+    
+    SECTION("parseDouble") {
+        const auto parse = [](const std::string& text, double& result) {
+            return Liquid::parseDouble(text.data(), text.data() + text.size(), result);
+        };
+        double result = 0;
+        const char* exact[] = {"0.1", "19.99", "-32.84", "32.", "3", "1.2345678901234", "0.0000000000000000000001",
+            "123456789.123456789", "1.00000000000000000000000001", "-0.30000000000000004"};
+        for (const char* text : exact) {
+            CHECK(parse(text, result));
+            CHECK(result == std::stod(text));
+        }
+        CHECK_FALSE(parse("", result));
+        CHECK_FALSE(parse("-", result));
+        CHECK_FALSE(parse(".", result));
+        CHECK_FALSE(parse("1.2.3", result));
+        CHECK_FALSE(parse("1e5", result));
+        const Liquid::String input = "x 19.99 y";
+        CHECK(Liquid::StringRef(&input, 2, 5).toDouble() == 19.99);
+        CHECK(Liquid::StringRef(&input, 2, 2).toInt() == 19);
+        CHECK_THROWS_AS(Liquid::StringRef(&input, 0, 3).toInt(), std::invalid_argument);
+    }
 
 }
 
@@ -1,6 +1,10 @@
 #ifndef LIQUID_STRINGUTILS_HPP
 #define LIQUID_STRINGUTILS_HPP
 
+#include <cstdint>
+#include <limits>
+#include <string>
+
 namespace Liquid {
     
     class StringRef;
@@ -13,10 +17,84 @@ namespace Liquid {
     
     String doubleToString(double value, int precision = 6);
     
+    // 64-bit FNV-1a hash of the raw characters.
+    uint64_t hash64(const String& input);
+    uint64_t hash64(const StringRef& input);
+    
     template <typename T>
     bool isSpace(const T ch) {
         return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
     }
+    
+    // Locale-independent parsing of numbers as the lexer scans them: an
+    // optional '-' and digits and, for parseDouble, optionally a '.' and
+    // more digits. Both read [begin, end) in place without allocating, and
+    // return false if it is not such a number or, for parseInt, does not
+    // fit in an int.
+    
+    template <typename Char>
+    bool parseInt(const Char* begin, const Char* end, int& result) {
+        const bool negative = begin != end && *begin == '-';
+        const Char* p = negative ? begin + 1 : begin;
+        if (p == end) {
+            return false;
+        }
+        const long long limit = static_cast<long long>(std::numeric_limits<int>::max()) + (negative ? 1 : 0);
+        long long value = 0;
+        for (; p != end; ++p) {
+            if (*p < '0' || *p > '9') {
+                return false;
+            }
+            value = value * 10 + (*p - '0');
+            if (value > limit) {
+                return false;
+            }
+        }
+        result = static_cast<int>(negative ? -value : value);
+        return true;
+    }
+    
+    // Parses text that parseDouble() cannot convert exactly.
+    bool parseDoubleSlow(const std::string& text, double& result);
+    
+    template <typename Char>
+    bool parseDouble(const Char* begin, const Char* end, double& result) {
+        // A mantissa of up to 15 digits and a power of ten up to 1e22 are
+        // exact doubles, so one division gives the correctly rounded result.
+        static const double kPowersOfTen[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+        };
+        const bool negative = begin != end && *begin == '-';
+        const Char* p = negative ? begin + 1 : begin;
+        uint64_t mantissa = 0;
+        int digits = 0;
+        int fractionDigits = 0;
+        bool seenDot = false;
+        for (; p != end; ++p) {
+            if (*p == '.' && !seenDot) {
+                seenDot = true;
+            } else if (*p >= '0' && *p <= '9') {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                ++digits;
+                fractionDigits += seenDot ? 1 : 0;
+                if (digits > 15) {
+                    return parseDoubleSlow(std::string(begin, end), result);
+                }
+            } else {
+                return false;
+            }
+        }
+        if (digits == 0) {
+            return false;
+        }
+        if (fractionDigits > 22) {
+            return parseDoubleSlow(std::string(begin, end), result);
+        }
+        const double value = static_cast<double>(mantissa) / kPowersOfTen[fractionDigits];
+        result = negative ? -value : value;
+        return true;
+    }
 
 }
 
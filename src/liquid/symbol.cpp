@@ -0,0 +1,95 @@
+#include "symbol.hpp"
+#include <memory>
+#include <mutex>
+
+const Liquid::Symbol::Entry* Liquid::Symbol::entry(const String& name, bool create)
+{
+    // Entries are held by pointer so they stay put as the table grows.
+    static std::mutex mutex;
+    static StringKeyUnorderedMap<std::unique_ptr<Entry>> table;
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = table.find(name);
+    if (it != table.end()) {
+        return it->second.get();
+    }
+    if (!create) {
+        return nullptr;
+    }
+    std::unique_ptr<Entry> entry(new Entry{name, table.hash_function()(name)});
+    const Entry* result = entry.get();
+    table.emplace(name, std::move(entry));
+    return result;
+}
+
+Liquid::Symbol::Symbol()
+{
+    // Expressions default-construct symbols, so skip the table for those.
+    static const Entry* empty = entry(String(), true);
+    entry_ = empty;
+}
+
+Liquid::Symbol::Symbol(const String& name)
+    : entry_(entry(name, true))
+{
+}
+
+bool Liquid::Symbol::find(const String& name, Symbol& symbol)
+{
+    const Entry* found = entry(name, false);
+    if (!found) {
+        return false;
+    }
+    symbol.entry_ = found;
+    return true;
+}
+
+
+
+#ifdef TESTS
+
+#include "catch.hpp"
+#include <thread>
+#include <vector>
+
+TEST_CASE("Liquid::Symbol") {
+
+    SECTION("Intern") {
+        const Liquid::Symbol a("price");
+        const Liquid::Symbol b(Liquid::String("pri") + Liquid::String("ce"));
+        CHECK(a == b);
+        CHECK(&a.name() == &b.name());
+        CHECK(a.name() == "price");
+        CHECK(a != Liquid::Symbol("title"));
+        CHECK(Liquid::Symbol().name().isEmpty());
+        CHECK(a.hash() == Liquid::StringKeyUnorderedMap<int>().hash_function()(Liquid::String("price")));
+    }
+
+    SECTION("Find") {
+        Liquid::Symbol symbol;
+        CHECK_FALSE(Liquid::Symbol::find("never interned by anything", symbol));
+        CHECK(symbol == Liquid::Symbol());
+        const Liquid::Symbol interned("interned by this test");
+        CHECK(Liquid::Symbol::find("interned by this test", symbol));
+        CHECK(symbol == interned);
+    }
+
+    SECTION("Concurrent") {
+        std::vector<std::thread> threads;
+        std::vector<Liquid::Symbol> symbols(8);
+        for (size_t i = 0; i < symbols.size(); ++i) {
+            threads.emplace_back([&symbols, i] {
+                for (int j = 0; j < 100; ++j) {
+                    symbols[i] = Liquid::Symbol(Liquid::String("concurrent"));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (const auto& symbol : symbols) {
+            CHECK(symbol == Liquid::Symbol("concurrent"));
+        }
+    }
+}
+
+#endif
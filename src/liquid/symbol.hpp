@@ -0,0 +1,62 @@
+#ifndef LIQUID_SYMBOL_HPP
+#define LIQUID_SYMBOL_HPP
+
+#include "string.hpp"
+
+namespace Liquid {
+
+    // An interned name. All symbols with the same name share one entry, so
+    // they compare by pointer, and the entry keeps the name's hash so
+    // lookups don't compute it again. Templates intern the names they look
+    // up while parsing; entries are never freed.
+    class Symbol {
+    public:
+        // The empty name.
+        Symbol();
+
+        explicit Symbol(const String& name);
+
+        // Sets symbol and returns true if name has been interned, without
+        // interning it otherwise. A name that was never interned can't be
+        // bound to anything looked up by symbol.
+        static bool find(const String& name, Symbol& symbol);
+
+        const String& name() const {
+            return entry_->name;
+        }
+
+        // The same hash StringKeyUnorderedMap uses for the name.
+        std::size_t hash() const {
+            return entry_->hash;
+        }
+
+        bool operator==(const Symbol& other) const {
+            return entry_ == other.entry_;
+        }
+
+        bool operator!=(const Symbol& other) const {
+            return entry_ != other.entry_;
+        }
+
+    private:
+        struct Entry {
+            String name;
+            std::size_t hash;
+        };
+
+        // Returns the entry for name, or null if there is none and create
+        // is false.
+        static const Entry* entry(const String& name, bool create);
+
+        const Entry* entry_;
+    };
+
+    struct SymbolHash {
+        std::size_t operator()(const Symbol& symbol) const {
+            return symbol.hash();
+        }
+    };
+
+}
+
+#endif
@@ -8,10 +8,15 @@ namespace Liquid {
     
     class Context;
     class Tokenizer;
+    class BinaryReader;
     
     using TagHandler = std::function<NodePtr(const Context& context, const StringRef& tagName, const StringRef& markup, Tokenizer& tokenizer)>;
     using TagHash = StringKeyUnorderedMap<TagHandler>;
     
+    // Recreates a tag from its serialized form, see TagNode::serialize().
+    using TagLoader = std::function<NodePtr(const Context& context, const StringRef& tagName, BinaryReader& reader)>;
+    using TagLoaderHash = StringKeyUnorderedMap<TagLoader>;
+    
 }
 
 #endif
@@ -1,5 +1,6 @@
 #include "assign.hpp"
 #include "context.hpp"
+#include "serializer.hpp"
 #include "template.hpp"
 
 Liquid::AssignTag::AssignTag(const Context& context, const StringRef& tagName, const StringRef& markup)
@@ -7,15 +8,38 @@ Liquid::AssignTag::AssignTag(const Context& context, const StringRef& tagName, c
 {
     Parser parser(markup);
     to_ = parser.consume(Token::Type::Id);
+    toSymbol_ = Symbol(to_.toString());
     (void)parser.consume(Token::Type::Equal);
     from_ = Variable(parser);
+    from_.fold(context);
+}
+
+Liquid::AssignTag::AssignTag(const Context& context, const StringRef& tagName, BinaryReader& reader)
+    : TagNode(context, tagName, reader)
+    , to_(reader.readStringRef())
+    , toSymbol_(to_.toString())
+    , from_(reader)
+{
+    from_.fold(context);
+}
+
+void Liquid::AssignTag::shiftSource(const String* source, std::ptrdiff_t delta)
+{
+    to_.shift(source, delta);
+    from_.shiftSource(source, delta);
+    TagNode::shiftSource(source, delta);
+}
+
+void Liquid::AssignTag::serialize(BinaryWriter& writer) const
+{
+    TagNode::serialize(writer);
+    writer.writeStringRef(to_);
+    from_.serialize(writer);
 }
     
-Liquid::String Liquid::AssignTag::render(Context& ctx)
+void Liquid::AssignTag::render(Context& ctx, OutputSink&) const
 {
-    Data& data = ctx.data();
-    data.insert(to_.toString(), from_.evaluate(ctx));
-    return "";
+    ctx.assign(toSymbol_, from_.evaluate(ctx));
 }
 
 
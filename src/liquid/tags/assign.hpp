@@ -8,11 +8,15 @@ namespace Liquid {
     class AssignTag : public TagNode {
     public:
         AssignTag(const Context& context, const StringRef& tagName, const StringRef& markup);
+        AssignTag(const Context& context, const StringRef& tagName, BinaryReader& reader);
         
-        virtual String render(Context& ctx) override;
+        virtual void render(Context& ctx, OutputSink& out) const override;
+        virtual void serialize(BinaryWriter& writer) const override;
+        virtual void shiftSource(const String* source, std::ptrdiff_t delta) override;
         
     private:
         StringRef to_;
+        Symbol toSymbol_;
         Variable from_;
     };
 }
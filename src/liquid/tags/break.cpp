@@ -1,8 +1,13 @@
 #include "break.hpp"
 #include "context.hpp"
+#include "program.hpp"
 
-Liquid::String Liquid::BreakTag::render(Context& ctx)
+void Liquid::BreakTag::render(Context& ctx, OutputSink&) const
 {
     ctx.push_interrupt(Context::Interrupt::Break);
-    return "";
+}
+
+void Liquid::BreakTag::compile(Compiler& compiler) const
+{
+    compiler.emitBreak();
 }
@@ -1,6 +1,7 @@
 #include "capture.hpp"
 #include "parser.hpp"
 #include "context.hpp"
+#include "serializer.hpp"
 #include "template.hpp"
 
 Liquid::CaptureTag::CaptureTag(const Context& context, const StringRef& tagName, const StringRef& markup)
@@ -8,14 +9,32 @@ Liquid::CaptureTag::CaptureTag(const Context& context, const StringRef& tagName,
 {
     Parser parser(markup);
     to_ = parser.consume(Token::Type::Id);
+    toSymbol_ = Symbol(to_.toString());
     (void)parser.consume(Token::Type::EndOfString);
 }
 
-Liquid::String Liquid::CaptureTag::render(Context& context)
+Liquid::CaptureTag::CaptureTag(const Context& context, const StringRef& tagName, BinaryReader& reader)
+    : BlockTag(context, tagName, reader)
+    , to_(reader.readStringRef())
+    , toSymbol_(to_.toString())
 {
-    const String output = BlockTag::render(context);
-    context.data().insert(to_.toString(), output);
-    return "";
+}
+
+void Liquid::CaptureTag::shiftSource(const String* source, std::ptrdiff_t delta)
+{
+    to_.shift(source, delta);
+    BlockTag::shiftSource(source, delta);
+}
+
+void Liquid::CaptureTag::serialize(BinaryWriter& writer) const
+{
+    BlockTag::serialize(writer);
+    writer.writeStringRef(to_);
+}
+
+void Liquid::CaptureTag::render(Context& context, OutputSink&) const
+{
+    context.assign(toSymbol_, body_.render(context));
 }
 
 
@@ -8,11 +8,15 @@ namespace Liquid {
     class CaptureTag : public BlockTag {
     public:
         CaptureTag(const Context& context, const StringRef& tagName, const StringRef& markup);
+        CaptureTag(const Context& context, const StringRef& tagName, BinaryReader& reader);
         
-        virtual String render(Context& context) override;
+        virtual void render(Context& context, OutputSink& out) const override;
+        virtual void serialize(BinaryWriter& writer) const override;
+        virtual void shiftSource(const String* source, std::ptrdiff_t delta) override;
         
     private:
         StringRef to_;
+        Symbol toSymbol_;
     };
 }
 
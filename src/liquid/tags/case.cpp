@@ -1,6 +1,7 @@
 #include "case.hpp"
 #include "parser.hpp"
 #include "context.hpp"
+#include "serializer.hpp"
 #include "template.hpp"
 #include "error.hpp"
 
@@ -12,6 +13,50 @@ Liquid::CaseTag::CaseTag(const Context& context, const StringRef& tagName, const
     (void)parser.consume(Token::Type::EndOfString);
 }
 
+Liquid::CaseTag::CaseTag(const Context& context, const StringRef& tagName, BinaryReader& reader)
+    : BlockTag(context, tagName, reader)
+    , left_(Expression::load(reader))
+{
+    const auto count = reader.readSize();
+    for (uint64_t i = 0; i < count; ++i) {
+        if (reader.readBool()) {
+            conditions_.emplace_back(true, BlockBody());
+        } else {
+            std::vector<Expression> expressions;
+            const auto expressionCount = reader.readSize();
+            for (uint64_t j = 0; j < expressionCount; ++j) {
+                expressions.push_back(Expression::load(reader));
+            }
+            conditions_.emplace_back(expressions, BlockBody());
+        }
+        conditions_.back().block().load(context, reader);
+    }
+}
+
+void Liquid::CaseTag::visitBodies(const std::function<void(BlockBody&)>& visitor)
+{
+    for (auto& cond : conditions_) {
+        visitor(cond.block());
+    }
+}
+
+void Liquid::CaseTag::serialize(BinaryWriter& writer) const
+{
+    BlockTag::serialize(writer);
+    left_.serialize(writer);
+    writer.writeSize(conditions_.size());
+    for (const auto& cond : conditions_) {
+        writer.writeBool(cond.isElse());
+        if (!cond.isElse()) {
+            writer.writeSize(cond.expressions().size());
+            for (const auto& exp : cond.expressions()) {
+                exp.serialize(writer);
+            }
+        }
+        cond.block().serialize(writer);
+    }
+}
+
 void Liquid::CaseTag::parse(const Context& context, Tokenizer& tokenizer)
 {
     BlockBody body;
@@ -21,26 +66,25 @@ void Liquid::CaseTag::parse(const Context& context, Tokenizer& tokenizer)
     }
 }
 
-Liquid::String Liquid::CaseTag::render(Context& context)
+void Liquid::CaseTag::render(Context& context, OutputSink& out) const
 {
-    String output;
     bool executeElseBlock = true;
-    const Data leftValue = left_.evaluate(context.data());
+    const Data leftValue = left_.evaluate(context);
     for (auto& cond : conditions_) {
         if (cond.isElse()) {
             if (executeElseBlock) {
-                return cond.block().render(context);
+                cond.block().render(context, out);
+                return;
             }
         } else {
             for (const auto& exp : cond.expressions()) {
-                if (exp.evaluate(context.data()) == leftValue) {
+                if (exp.evaluate(context) == leftValue) {
                     executeElseBlock = false;
-                    output += cond.block().render(context);
+                    cond.block().render(context, out);
                 }
             }
         }
     }
-    return output;
 }
 
 void Liquid::CaseTag::handleUnknownTag(const StringRef& tagName, const StringRef& markup, Tokenizer& tokenizer)
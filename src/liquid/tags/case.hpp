@@ -9,10 +9,13 @@ namespace Liquid {
     class CaseTag : public BlockTag {
     public:
         CaseTag(const Context& context, const StringRef& tagName, const StringRef& markup);
+        CaseTag(const Context& context, const StringRef& tagName, BinaryReader& reader);
         
         virtual void parse(const Context& context, Tokenizer& tokenizer) override;
         
-        virtual String render(Context& context) override;
+        virtual void render(Context& context, OutputSink& out) const override;
+        virtual void serialize(BinaryWriter& writer) const override;
+        virtual void visitBodies(const std::function<void(BlockBody&)>& visitor) override;
         
     protected:
         virtual void handleUnknownTag(const StringRef& tagName, const StringRef& markup, Tokenizer& tokenizer) override;
@@ -39,6 +42,9 @@ namespace Liquid {
             const std::vector<Expression>& expressions() const {
                 return expressions_;
             }
+            const BlockBody& block() const {
+                return block_;
+            }
             BlockBody& block() {
                 return block_;
             }
@@ -11,9 +11,22 @@ namespace Liquid {
             : BlockTag(context, tagName, markup)
         {
         }
+        CommentTag(const Context& context, const StringRef& tagName, BinaryReader& reader)
+            : BlockTag(context, tagName, reader)
+        {
+        }
+        
+        virtual void render(Context&, OutputSink&) const override {
+        }
+        
+        virtual void compile(Compiler&) const override {
+        }
+        
+        virtual void visitBodies(const std::function<void(BlockBody&)>&) override {
+        }
         
-        virtual String render(Context&) override {
-            return "";
+        virtual bool appendStaticText(const Context&, String&) const override {
+            return true;
         }
 
     protected:
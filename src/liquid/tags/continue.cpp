@@ -1,8 +1,13 @@
 #include "continue.hpp"
 #include "context.hpp"
+#include "program.hpp"
 
-Liquid::String Liquid::ContinueTag::render(Context& ctx)
+void Liquid::ContinueTag::render(Context& ctx, OutputSink&) const
 {
     ctx.push_interrupt(Context::Interrupt::Continue);
-    return "";
+}
+
+void Liquid::ContinueTag::compile(Compiler& compiler) const
+{
+    compiler.emitContinue();
 }
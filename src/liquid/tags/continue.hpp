@@ -10,8 +10,12 @@ namespace Liquid {
         ContinueTag(const Context& context, const StringRef& tagName, const StringRef& markup)
             : TagNode(context, tagName, markup)
         {}
+        ContinueTag(const Context& context, const StringRef& tagName, BinaryReader& reader)
+            : TagNode(context, tagName, reader)
+        {}
         
-        virtual String render(Context& ctx) override;
+        virtual void render(Context& ctx, OutputSink& out) const override;
+        virtual void compile(Compiler& compiler) const override;
     };
 }
 
@@ -1,6 +1,8 @@
 #include "cycle.hpp"
 #include "parser.hpp"
 #include "context.hpp"
+#include "serializer.hpp"
+#include "error.hpp"
 #include "template.hpp"
 
 Liquid::CycleTag::CycleTag(const Context& context, const StringRef& tagName, const StringRef& markup)
@@ -29,7 +31,34 @@ Liquid::CycleTag::CycleTag(const Context& context, const StringRef& tagName, con
     }
 }
 
-Liquid::String Liquid::CycleTag::render(Context& context)
+Liquid::CycleTag::CycleTag(const Context& context, const StringRef& tagName, BinaryReader& reader)
+    : TagNode(context, tagName, reader)
+    , nameExpression_(Expression::load(reader))
+    , nameString_(reader.readString())
+{
+    const auto count = reader.readSize();
+    for (uint64_t i = 0; i < count; ++i) {
+        expressions_.push_back(Expression::load(reader));
+    }
+    nameIsExpression_ = reader.readBool();
+    if (expressions_.empty()) {
+        throw serialization_error("Invalid cycle tag in serialized template");
+    }
+}
+
+void Liquid::CycleTag::serialize(BinaryWriter& writer) const
+{
+    TagNode::serialize(writer);
+    nameExpression_.serialize(writer);
+    writer.writeString(nameString_);
+    writer.writeSize(expressions_.size());
+    for (const auto& expression : expressions_) {
+        expression.serialize(writer);
+    }
+    writer.writeBool(nameIsExpression_);
+}
+
+void Liquid::CycleTag::render(Context& context, OutputSink& out) const
 {
     Data::Hash& registers = context.registers();
     const String name = tagName().toString();
@@ -38,17 +67,17 @@ Liquid::String Liquid::CycleTag::render(Context& context)
     }
     int iteration = 0;
     Data& reg = registers[name];
-    const String lookupKey = nameIsExpression_ ? nameExpression_.evaluate(context.data()).toString() : nameString_;
+    const String lookupKey = nameIsExpression_ ? nameExpression_.evaluate(context).toString() : nameString_;
     if (reg.containsKey(lookupKey)) {
         iteration = reg[lookupKey].toInt();
     }
-    const String result = expressions_[iteration].evaluate(context.data()).toString();
+    const String result = expressions_[iteration].evaluate(context).toString();
     ++iteration;
     if (iteration >= static_cast<int>(expressions_.size())) {
         iteration = 0;
     }
     reg.insert(lookupKey, iteration);
-    return result;
+    out.append(result);
 }
 
 
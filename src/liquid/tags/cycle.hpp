@@ -9,8 +9,10 @@ namespace Liquid {
     class CycleTag : public TagNode {
     public:
         CycleTag(const Context& context, const StringRef& tagName, const StringRef& markup);
+        CycleTag(const Context& context, const StringRef& tagName, BinaryReader& reader);
         
-        virtual String render(Context& context) override;
+        virtual void render(Context& context, OutputSink& out) const override;
+        virtual void serialize(BinaryWriter& writer) const override;
         
     private:
         Expression nameExpression_;
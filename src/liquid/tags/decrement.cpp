@@ -1,6 +1,7 @@
 #include "decrement.hpp"
 #include "parser.hpp"
 #include "context.hpp"
+#include "serializer.hpp"
 #include "template.hpp"
 
 Liquid::DecrementTag::DecrementTag(const Context& context, const StringRef& tagName, const StringRef& markup)
@@ -11,13 +12,31 @@ Liquid::DecrementTag::DecrementTag(const Context& context, const StringRef& tagN
     (void)parser.consume(Token::Type::EndOfString);
 }
 
-Liquid::String Liquid::DecrementTag::render(Context& context)
+Liquid::DecrementTag::DecrementTag(const Context& context, const StringRef& tagName, BinaryReader& reader)
+    : TagNode(context, tagName, reader)
+    , to_(reader.readStringRef())
+{
+}
+
+void Liquid::DecrementTag::shiftSource(const String* source, std::ptrdiff_t delta)
+{
+    to_.shift(source, delta);
+    TagNode::shiftSource(source, delta);
+}
+
+void Liquid::DecrementTag::serialize(BinaryWriter& writer) const
+{
+    TagNode::serialize(writer);
+    writer.writeStringRef(to_);
+}
+
+void Liquid::DecrementTag::render(Context& context, OutputSink& out) const
 {
     Data::Hash& env = context.environments();
     const String name = to_.toString();
     const int value = env[name].toInt() - 1;
     env[name] = value;
-    return String(std::to_string(value));
+    out.append(String(std::to_string(value)));
 }
 
 
@@ -1,6 +1,8 @@
 #include "for.hpp"
 #include "parser.hpp"
 #include "context.hpp"
+#include "serializer.hpp"
+#include "program.hpp"
 #include "template.hpp"
 #include "drop.hpp"
 #include "error.hpp"
@@ -79,12 +81,30 @@ namespace Liquid {
     
 }
 
+namespace {
+    // Whether the value of collection can be freed by an assign while it is
+    // looped over: it was found under a name the render assigned, or under
+    // a name only known while rendering.
+    bool mayReassign(const Liquid::Expression& collection, const Liquid::Context& context)
+    {
+        if (collection.isLookupKey()) {
+            return context.ownsBinding(collection.symbol());
+        }
+        if (collection.isLookup() && !collection.lookups().empty()) {
+            const Liquid::Expression& root = collection.lookups().front();
+            return !root.isLookupKey() || context.ownsBinding(root.symbol());
+        }
+        return false;
+    }
+}
+
 Liquid::ForTag::ForTag(const Context& context, const StringRef& tagName, const StringRef& markup)
     : BlockTag(context, tagName, markup)
     , range_(false)
 {
     Parser parser(markup);
     varName_ = parser.consume(Token::Type::Id);
+    varSymbol_ = Symbol(varName_.toString());
     if (parser.consume(Token::Type::Id) != "in") {
         throw syntax_error("Syntax Error in 'for loop' - Valid syntax: for [item] in [collection]");
     }
@@ -114,6 +134,41 @@ Liquid::ForTag::ForTag(const Context& context, const StringRef& tagName, const S
     (void)parser.consume(Token::Type::EndOfString);
 }
 
+Liquid::ForTag::ForTag(const Context& context, const StringRef& tagName, BinaryReader& reader)
+    : BlockTag(context, tagName, reader)
+    , varName_(reader.readStringRef())
+    , varSymbol_(varName_.toString())
+{
+    elseBlock_.load(context, reader);
+    range_ = reader.readBool();
+    rangeStart_ = Expression::load(reader);
+    rangeEnd_ = Expression::load(reader);
+    collection_ = Expression::load(reader);
+    reversed_ = reader.readBool();
+    offset_ = Expression::load(reader);
+    limit_ = Expression::load(reader);
+}
+
+void Liquid::ForTag::shiftSource(const String* source, std::ptrdiff_t delta)
+{
+    varName_.shift(source, delta);
+    BlockTag::shiftSource(source, delta);
+}
+
+void Liquid::ForTag::serialize(BinaryWriter& writer) const
+{
+    BlockTag::serialize(writer);
+    writer.writeStringRef(varName_);
+    elseBlock_.serialize(writer);
+    writer.writeBool(range_);
+    rangeStart_.serialize(writer);
+    rangeEnd_.serialize(writer);
+    collection_.serialize(writer);
+    writer.writeBool(reversed_);
+    offset_.serialize(writer);
+    limit_.serialize(writer);
+}
+
 void Liquid::ForTag::parse(const Context& context, Tokenizer& tokenizer)
 {
     if (!parseBody(context, &body_, tokenizer)) {
@@ -122,157 +177,117 @@ void Liquid::ForTag::parse(const Context& context, Tokenizer& tokenizer)
     (void)parseBody(context, &elseBlock_, tokenizer);
 }
 
-namespace Liquid {
-
-class ForHelper {
-public:
-    ForHelper(int start, int end, bool reversed)
-        : start_(start)
-        , end_(end)
-        , reversed_(reversed)
-        , i(reversed ? end_ : start_)
-    {
-    }
-    
-    bool condition() {
-        if (reversed_) {
-            return i >= start_;
-        } else {
-            return i <= end_;
+bool Liquid::ForLoopState::begin(const ForTag& tag, Context& context)
+{
+    int start;
+    int end;
+    if (tag.range_) {
+        start = tag.rangeStart_.evaluate(context).toInt();
+        end = tag.rangeEnd_.evaluate(context).toInt();
+        collection_ = nullptr;
+    } else {
+        collection_ = &tag.collection_.evaluate(context);
+        // The item is bound to an element of the collection rather than a
+        // copy. If the collection was found through a name the render
+        // assigned, the body could assign that name again and free it, so
+        // loop over a copy of it instead.
+        if (mayReassign(tag.collection_, context)) {
+            ownedCollection_ = std::make_shared<const Data>(*collection_);
+            collection_ = ownedCollection_.get();
         }
+        start = 0;
+        end = static_cast<int>(collection_->size()) - 1;
     }
-    
-    void next() {
-        if (reversed_) {
-            --i;
-        } else {
-            ++i;
+    stackName_ = tag.tagName().toString();
+    const Data& forStack = forStackData(context);
+    const size_t forStackSize = forStack.size();
+    std::shared_ptr<ForloopDrop> parent;
+    if (forStackSize > 0) {
+        parent = std::dynamic_pointer_cast<ForloopDrop>(forStack.at(forStackSize - 1).drop());
+        if (!parent) {
+            throw std::runtime_error("Null drop");
         }
     }
-    
-private:
-    int start_;
-    int end_;
-    bool reversed_;
-    
-public:
-    int i;
-};
+    const Data& limit = tag.limit_.evaluate(context);
+    const Data& offset = tag.offset_.evaluate(context);
+    start_ = offset.isNumber() ? offset.toInt() : start;
+    end_ = limit.isNumber() ? start_ + (limit.toInt() - 1) : end;
+    if (end_ < start_) {
+        return false;
+    }
+    varName_ = tag.varSymbol_;
+    reversed_ = tag.reversed_;
+    i_ = reversed_ ? end_ : start_;
+    started_ = false;
+    drop_ = std::make_shared<ForloopDrop>((end_ - start_) + 1, parent);
+    forStackData(context).push_back(Data{drop_});
+    context.pushScope();
+    static const Symbol forloop("forloop");
+    context.set(forloop, Data{drop_});
+    return true;
+}
 
-class ForLoop {
-public:
-    using Item = std::function<Data(int i)>;
-    
-    ForLoop(const Item& item, BlockBody& body, const String& varName, int start, int end, const Data& limit, const Data& offset, bool reversed, const std::shared_ptr<ForloopDrop>& parent)
-        : item_(item)
-        , body_(body)
-        , varName_(varName)
-        , start_(offset.isNumber() ? offset.toInt() : start)
-        , end_(limit.isNumber() ? start_ + (limit.toInt() - 1) : end)
-        , len_((end_ - start_) + 1)
-        , empty_(end_ < start_)
-        , reversed_(reversed)
-        , drop_(std::make_shared<ForloopDrop>(len_, parent))
-    {
-    }
-    
-    bool empty() const {
-        return empty_;
-    }
-    
-    String render(Context& context) const {
-        String output;
-        Data& data = context.data();
-        data.insert("forloop", Liquid::Data{drop_});
-        ForHelper loop(start_, end_, reversed_);
-        for (; loop.condition(); loop.next(), drop_->increment()) {
-            data.insert(varName_, item_(loop.i));
-            output += body_.render(context);
-            if (context.haveInterrupt()) {
-                const Context::Interrupt interrupt = context.pop_interrupt();
-                if (interrupt == Context::Interrupt::Break) {
-                    break;
-                } else if (interrupt == Context::Interrupt::Continue) {
-                    continue;
-                }
-            }
-        }
-        return output;
-    }
-    
-    std::shared_ptr<ForloopDrop> drop() const {
-        return drop_;
+bool Liquid::ForLoopState::next(Context& context)
+{
+    if (started_) {
+        i_ += reversed_ ? -1 : 1;
+        drop_->increment();
     }
-    
-private:
-    const Item& item_;
-    BlockBody& body_;
-    const String varName_;
-    const int start_;
-    const int end_;
-    const int len_;
-    const bool empty_;
-    const bool reversed_;
-    std::shared_ptr<ForloopDrop> drop_;
-};
-
-class ArrayPusher {
-public:
-    ArrayPusher(Data& array, const Data& obj)
-        : array_(array)
-    {
-        array.push_back(obj);
+    started_ = true;
+    if (reversed_ ? i_ < start_ : i_ > end_) {
+        return false;
     }
-    ~ArrayPusher()
-    {
-        array_.pop_back();
+    if (collection_) {
+        context.bind(varName_, collection_->at(static_cast<size_t>(i_)));
+    } else {
+        context.set(varName_, Data(i_));
     }
-private:
-    Data& array_;
-};
+    return true;
+}
 
+void Liquid::ForLoopState::end(Context& context)
+{
+    context.popScope();
+    forStackData(context).pop_back();
 }
 
-Liquid::String Liquid::ForTag::render(Context& context)
+// Looked up each time rather than kept, since the body may add registers
+// and move this one.
+Liquid::Data& Liquid::ForLoopState::forStackData(Context& context) const
 {
-    Data& data = context.data();
-    int start;
-    int end;
-    ForLoop::Item item;
-    if (range_) {
-        start = rangeStart_.evaluate(data).toInt();
-        end = rangeEnd_.evaluate(data).toInt();
-        item = [](int i) {
-            return i;
-        };
-    } else {
-        const Data& collection = collection_.evaluate(data);
-        start = 0;
-        end = static_cast<int>(collection.size()) - 1;
-        item = [&collection](int i) {
-            return collection.at(static_cast<size_t>(i));
-        };
-    }
     Data::Hash& registers = context.registers();
-    const String name = tagName().toString();
-    if (registers.find(name) == registers.end()) {
-        registers[name] = Data::Array();
+    const auto it = registers.find(stackName_);
+    if (it != registers.end()) {
+        return it->second;
     }
-    Data& forStack = registers[name];
-    const size_t forStackSize = forStack.size();
-    std::shared_ptr<ForloopDrop> parent;
-    if (forStackSize > 0) {
-        parent = std::dynamic_pointer_cast<ForloopDrop>(forStack.at(forStackSize - 1).drop());
-        if (!parent) {
-            throw std::runtime_error("Null drop");
-        }
+    return registers[stackName_] = Data::Array();
+}
+
+void Liquid::ForTag::render(Context& context, OutputSink& out) const
+{
+    ForLoopState loop;
+    if (!loop.begin(*this, context)) {
+        elseBlock_.render(context, out);
+        return;
     }
-    const ForLoop loop(item, body_, varName_.toString(), start, end, limit_.evaluate(data), offset_.evaluate(data), reversed_, parent);
-    if (loop.empty()) {
-        return elseBlock_.render(context);
+    while (loop.next(context)) {
+        body_.render(context, out);
+        if (context.haveInterrupt() && context.pop_interrupt() == Context::Interrupt::Break) {
+            break;
+        }
     }
-    const ArrayPusher pusher(forStack, Data{loop.drop()});
-    return loop.render(context);
+    loop.end(context);
+}
+
+void Liquid::ForTag::visitBodies(const std::function<void(BlockBody&)>& visitor)
+{
+    visitor(body_);
+    visitor(elseBlock_);
+}
+
+void Liquid::ForTag::compile(Compiler& compiler) const
+{
+    compiler.compileLoop(*this, body_, elseBlock_);
 }
 
 void Liquid::ForTag::handleUnknownTag(const StringRef& tagName, const StringRef& markup, Tokenizer& tokenizer)
@@ -735,6 +750,48 @@ TEST_CASE("Liquid::For") {
             hash
         );
     }
+    
+    SECTION("ForScope") {
+        Liquid::Data::Hash hash;
+        hash["array"] = Liquid::Data::Array{1, 2, 3};
+        hash["item"] = "outer";
+        CHECK_TEMPLATE_DATA_RESULT(
+            "{% for item in array %}{{ item }}{% endfor %} {{ item }}",
+            "123 outer",
+            hash
+        );
+        CHECK_TEMPLATE_DATA_RESULT(
+            "{% for i in array %}{% endfor %}[{{ i }}][{{ forloop.index }}]",
+            "[][]",
+            hash
+        );
+        CHECK_TEMPLATE_DATA_RESULT(
+            "{% for i in array %}{% assign last = i %}{% endfor %}{{ last }}",
+            "3",
+            hash
+        );
+        CHECK_TEMPLATE_DATA_RESULT(
+            "{% for i in (1..2) %}{% for i in array %}{{ i }}{% endfor %}{{ i }} {% endfor %}",
+            "1231 1232 ",
+            hash
+        );
+    }
+    
+    SECTION("ForReassignCollection") {
+        // The loop keeps going over the collection it started with.
+        CHECK_TEMPLATE_RESULT(
+            "{% assign arr = \"a,b,c\" | split: \",\" %}{% for x in arr %}{% assign arr = \"d,e,f\" | split: \",\" %}{{ x }}{% endfor %}{{ arr | join: \"\" }}",
+            "abcdef"
+        );
+        CHECK_TEMPLATE_RESULT(
+            "{% assign arr = \"a,b,c\" | split: \",\" %}{% for x in arr %}{% capture arr %}d{% endcapture %}{{ x }}{% endfor %}{{ arr }}",
+            "abcd"
+        );
+        CHECK_TEMPLATE_RESULT(
+            "{% assign h = \"a,b\" | split: \",\" %}{% for x in h %}{% for y in h %}{% assign h = 1 %}{{ x }}{{ y }}{% endfor %}{% endfor %}",
+            "aaab"
+        );
+    }
 
 }
 
@@ -6,19 +6,61 @@
 
 namespace Liquid {
     
+    class ForTag;
+    class ForloopDrop;
+    
+    // One run of a for loop over its items. ForTag::render() renders the
+    // tag's body for each item, compiled templates run the compiled body.
+    class ForLoopState {
+    public:
+        // Evaluates the loop bounds, returns false if there are no items.
+        bool begin(const ForTag& tag, Context& context);
+        
+        // Moves to the next item and assigns it to the loop variable,
+        // returns false after the last one.
+        bool next(Context& context);
+        
+        // Must be called after a successful begin().
+        void end(Context& context);
+        
+    private:
+        Data& forStackData(Context& context) const;
+        
+        const Data* collection_ = nullptr;
+        // A copy of the collection when the loop's body could free it, see
+        // begin(). On the heap so the state can move, e.g. in a vector.
+        std::shared_ptr<const Data> ownedCollection_;
+        String stackName_;
+        Symbol varName_;
+        int start_ = 0;
+        int end_ = 0;
+        int i_ = 0;
+        bool reversed_ = false;
+        bool started_ = false;
+        std::shared_ptr<ForloopDrop> drop_;
+    };
+    
     class ForTag : public BlockTag {
     public:
         ForTag(const Context& context, const StringRef& tagName, const StringRef& markup);
+        ForTag(const Context& context, const StringRef& tagName, BinaryReader& reader);
         
         virtual void parse(const Context& context, Tokenizer& tokenizer) override;
         
-        virtual String render(Context& context) override;
+        virtual void render(Context& context, OutputSink& out) const override;
+        virtual void serialize(BinaryWriter& writer) const override;
+        virtual void shiftSource(const String* source, std::ptrdiff_t delta) override;
+        virtual void compile(Compiler& compiler) const override;
+        virtual void visitBodies(const std::function<void(BlockBody&)>& visitor) override;
         
     protected:
         virtual void handleUnknownTag(const StringRef& tagName, const StringRef& markup, Tokenizer& tokenizer) override;
         
     private:
+        friend class ForLoopState;
+        
         StringRef varName_;
+        Symbol varSymbol_;
         BlockBody elseBlock_;
         bool range_;
         Expression rangeStart_;
@@ -1,6 +1,9 @@
 #include "if.hpp"
 #include "parser.hpp"
 #include "context.hpp"
+#include "serializer.hpp"
+#include "error.hpp"
+#include "program.hpp"
 #include "template.hpp"
 
 Liquid::IfTag::IfTag(bool unless, const Context& context, const StringRef& tagName, const StringRef& markup)
@@ -11,6 +14,30 @@ Liquid::IfTag::IfTag(bool unless, const Context& context, const StringRef& tagNa
     parseTag(markup);
 }
 
+Liquid::IfTag::IfTag(const Context& context, const StringRef& tagName, BinaryReader& reader)
+    : BlockTag(context, tagName, reader)
+    , if_(reader.readBool())
+{
+    const auto count = reader.readSize();
+    for (uint64_t i = 0; i < count; ++i) {
+        blocks_.emplace_back(reader.readBool());
+        blocks_.back().cond = Condition::load(reader);
+        blocks_.back().body.load(context, reader);
+    }
+}
+
+void Liquid::IfTag::serialize(BinaryWriter& writer) const
+{
+    BlockTag::serialize(writer);
+    writer.writeBool(if_);
+    writer.writeSize(blocks_.size());
+    for (const auto& block : blocks_) {
+        writer.writeBool(block.isElse);
+        block.cond.serialize(writer);
+        block.body.serialize(writer);
+    }
+}
+
 void Liquid::IfTag::parseTag(const StringRef& markup)
 {
     Parser parser(markup);
@@ -66,15 +93,66 @@ Liquid::Condition Liquid::IfTag::parseCondition(Parser& parser)
     return Condition(a);
 }
 
-Liquid::String Liquid::IfTag::render(Context& context)
+void Liquid::IfTag::render(Context& context, OutputSink& out) const
 {
     for (auto& block : blocks_) {
         const bool result = block.cond.evaluate(context);
         if (block.isElse || (if_ && result) || (!if_ && !result)) {
-            return block.body.render(context);
+            block.body.render(context, out);
+            return;
         }
     }
-    return "";
+}
+
+void Liquid::IfTag::compile(Compiler& compiler) const
+{
+    std::vector<size_t> jumpsToEnd;
+    for (auto& block : blocks_) {
+        if (block.isElse) {
+            compiler.compile(block.body);
+            break;
+        }
+        const size_t skip = compiler.emitJumpUnless(block.cond, if_);
+        compiler.compile(block.body);
+        if (&block != &blocks_.back()) {
+            jumpsToEnd.push_back(compiler.emitJump());
+        }
+        compiler.setTarget(skip);
+    }
+    for (const size_t jump : jumpsToEnd) {
+        compiler.setTarget(jump);
+    }
+}
+
+void Liquid::IfTag::visitBodies(const std::function<void(BlockBody&)>& visitor)
+{
+    for (auto& block : blocks_) {
+        visitor(block.body);
+    }
+}
+
+bool Liquid::IfTag::appendStaticText(const Context& context, String& text) const
+{
+    Data scratch(Data::Type::Hash);
+    Context evaluationContext(scratch, context.filters(), context.tags());
+    for (const auto& block : blocks_) {
+        if (!block.isElse) {
+            if (!block.cond.isLiteral()) {
+                return false;
+            }
+            bool result;
+            try {
+                result = block.cond.evaluate(evaluationContext);
+            } catch (const std::exception&) {
+                return false;
+            }
+            if (result != if_) {
+                continue;
+            }
+        }
+        return block.body.appendStaticText(context, text);
+    }
+    return true;
 }
 
 void Liquid::IfTag::handleUnknownTag(const StringRef& tagName, const StringRef& markup, Tokenizer& tokenizer)
@@ -89,12 +167,43 @@ void Liquid::IfTag::handleUnknownTag(const StringRef& tagName, const StringRef&
     }
 }
 
-bool Liquid::Condition::evaluate(Context& context)
+void Liquid::Condition::serialize(BinaryWriter& writer) const
+{
+    a_.serialize(writer);
+    writer.writeByte(static_cast<uint8_t>(op_));
+    b_.serialize(writer);
+    writer.writeByte(static_cast<uint8_t>(logicalOp_));
+    if (logicalOp_ != LogicalOperator::None) {
+        child_->serialize(writer);
+    }
+}
+
+Liquid::Condition Liquid::Condition::load(BinaryReader& reader)
+{
+    Condition cond;
+    cond.a_ = Expression::load(reader);
+    const uint8_t op = reader.readByte();
+    if (op > static_cast<uint8_t>(Operator::Contains)) {
+        throw serialization_error("Invalid condition in serialized template");
+    }
+    cond.op_ = static_cast<Operator>(op);
+    cond.b_ = Expression::load(reader);
+    const uint8_t logicalOp = reader.readByte();
+    if (logicalOp > static_cast<uint8_t>(LogicalOperator::Or)) {
+        throw serialization_error("Invalid condition in serialized template");
+    }
+    cond.logicalOp_ = static_cast<LogicalOperator>(logicalOp);
+    if (cond.logicalOp_ != LogicalOperator::None) {
+        cond.child_ = std::make_shared<Condition>(load(reader));
+    }
+    return cond;
+}
+
+bool Liquid::Condition::evaluate(Context& context) const
 {
     bool result;
-    Data& data = context.data();
-    const Data& v1 = a_.evaluate(data);
-    const Data& v2 = b_.evaluate(data);
+    const Data& v1 = a_.evaluate(context);
+    const Data& v2 = b_.evaluate(context);
     switch (op_) {
         case Operator::None:
             result = v1.isTruthy();
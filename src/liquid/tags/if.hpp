@@ -52,7 +52,15 @@ namespace Liquid {
             child_ = cond;
         }
         
-        bool evaluate(Context& context);
+        bool evaluate(Context& context) const;
+        
+        // Has the same result whatever the data.
+        bool isLiteral() const {
+            return a_.isLiteral() && b_.isLiteral() && (!child_ || child_->isLiteral());
+        }
+        
+        void serialize(BinaryWriter& writer) const;
+        static Condition load(BinaryReader& reader);
     private:
         Expression a_;
         Operator op_;
@@ -72,10 +80,15 @@ namespace Liquid {
     class IfTag : public BlockTag {
     public:
         IfTag(bool unless, const Context& context, const StringRef& tagName, const StringRef& markup);
+        IfTag(const Context& context, const StringRef& tagName, BinaryReader& reader);
         
         virtual void parse(const Context& context, Tokenizer& tokenizer) override;
         
-        virtual String render(Context& context) override;
+        virtual void render(Context& context, OutputSink& out) const override;
+        virtual void serialize(BinaryWriter& writer) const override;
+        virtual void compile(Compiler& compiler) const override;
+        virtual void visitBodies(const std::function<void(BlockBody&)>& visitor) override;
+        virtual bool appendStaticText(const Context& context, String& text) const override;
         
     protected:
         virtual void handleUnknownTag(const StringRef& tagName, const StringRef& markup, Tokenizer& tokenizer) override;
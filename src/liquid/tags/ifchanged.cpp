@@ -1,6 +1,7 @@
 #include "ifchanged.hpp"
 #include "parser.hpp"
 #include "context.hpp"
+#include "serializer.hpp"
 #include "template.hpp"
 
 Liquid::IfchangedTag::IfchangedTag(const Context& context, const StringRef& tagName, const StringRef& markup)
@@ -8,16 +9,20 @@ Liquid::IfchangedTag::IfchangedTag(const Context& context, const StringRef& tagN
 {
 }
 
-Liquid::String Liquid::IfchangedTag::render(Context& context)
+Liquid::IfchangedTag::IfchangedTag(const Context& context, const StringRef& tagName, BinaryReader& reader)
+    : BlockTag(context, tagName, reader)
 {
-    const String output = BlockTag::render(context);
+}
+
+void Liquid::IfchangedTag::render(Context& context, OutputSink& out) const
+{
+    const String output = body_.render(context);
     Data::Hash& registers = context.registers();
     const Data& current = registers["ifchanged"];
     if (current.toString() != output) {
         registers["ifchanged"] = output;
-        return output;
+        out.append(output);
     }
-    return "";
 }
 
 
@@ -8,8 +8,9 @@ namespace Liquid {
     class IfchangedTag : public BlockTag {
     public:
         IfchangedTag(const Context& context, const StringRef& tagName, const StringRef& markup);
+        IfchangedTag(const Context& context, const StringRef& tagName, BinaryReader& reader);
         
-        virtual String render(Context& context) override;
+        virtual void render(Context& context, OutputSink& out) const override;
     };
 }
 
@@ -1,6 +1,7 @@
 #include "increment.hpp"
 #include "parser.hpp"
 #include "context.hpp"
+#include "serializer.hpp"
 #include "template.hpp"
 
 Liquid::IncrementTag::IncrementTag(const Context& context, const StringRef& tagName, const StringRef& markup)
@@ -11,13 +12,31 @@ Liquid::IncrementTag::IncrementTag(const Context& context, const StringRef& tagN
     (void)parser.consume(Token::Type::EndOfString);
 }
 
-Liquid::String Liquid::IncrementTag::render(Context& context)
+Liquid::IncrementTag::IncrementTag(const Context& context, const StringRef& tagName, BinaryReader& reader)
+    : TagNode(context, tagName, reader)
+    , to_(reader.readStringRef())
+{
+}
+
+void Liquid::IncrementTag::shiftSource(const String* source, std::ptrdiff_t delta)
+{
+    to_.shift(source, delta);
+    TagNode::shiftSource(source, delta);
+}
+
+void Liquid::IncrementTag::serialize(BinaryWriter& writer) const
+{
+    TagNode::serialize(writer);
+    writer.writeStringRef(to_);
+}
+
+void Liquid::IncrementTag::render(Context& context, OutputSink& out) const
 {
     Data::Hash& env = context.environments();
     const String name = to_.toString();
     const int value = env[name].toInt();
     env[name] = value + 1;
-    return String(std::to_string(value));
+    out.append(String(std::to_string(value)));
 }
 
 
@@ -8,8 +8,11 @@ namespace Liquid {
     class IncrementTag : public TagNode {
     public:
         IncrementTag(const Context& context, const StringRef& tagName, const StringRef& markup);
+        IncrementTag(const Context& context, const StringRef& tagName, BinaryReader& reader);
         
-        virtual String render(Context& context) override;
+        virtual void render(Context& context, OutputSink& out) const override;
+        virtual void serialize(BinaryWriter& writer) const override;
+        virtual void shiftSource(const String* source, std::ptrdiff_t delta) override;
         
     private:
         StringRef to_;
@@ -15,8 +15,25 @@
 #include "ifchanged.hpp"
 #include "increment.hpp"
 #include "error.hpp"
+#include "serializer.hpp"
+#include "mappedfile.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    // Source of templates that have not been parsed, or have been moved
+    // from. Being shared, it is never edited in place.
+    const std::shared_ptr<Liquid::String>& emptySource() {
+        static const std::shared_ptr<Liquid::String> source = std::make_shared<Liquid::String>();
+        return source;
+    }
+}
 
 Liquid::Template::Template()
+    : source_(emptySource())
+    , averageOutputSize_(0)
 {
     StandardFilters::registerFilters(*this);
     
@@ -73,39 +90,550 @@ Liquid::Template::Template()
     tags_["increment"] = [](const Context& context, const StringRef& tagName, const StringRef& markup, Tokenizer&) {
         return std::make_shared<IncrementTag>(context, tagName, markup);
     };
+    
+    tagLoaders_["capture"] = [](const Context& context, const StringRef& tagName, BinaryReader& reader) {
+        return std::make_shared<CaptureTag>(context, tagName, reader);
+    };
+    tagLoaders_["case"] = [](const Context& context, const StringRef& tagName, BinaryReader& reader) {
+        return std::make_shared<CaseTag>(context, tagName, reader);
+    };
+    tagLoaders_["comment"] = [](const Context& context, const StringRef& tagName, BinaryReader& reader) {
+        return std::make_shared<CommentTag>(context, tagName, reader);
+    };
+    tagLoaders_["for"] = [](const Context& context, const StringRef& tagName, BinaryReader& reader) {
+        return std::make_shared<ForTag>(context, tagName, reader);
+    };
+    tagLoaders_["if"] = [](const Context& context, const StringRef& tagName, BinaryReader& reader) {
+        return std::make_shared<IfTag>(context, tagName, reader);
+    };
+    tagLoaders_["unless"] = tagLoaders_["if"];
+    tagLoaders_["ifchanged"] = [](const Context& context, const StringRef& tagName, BinaryReader& reader) {
+        return std::make_shared<IfchangedTag>(context, tagName, reader);
+    };
+    tagLoaders_["assign"] = [](const Context& context, const StringRef& tagName, BinaryReader& reader) {
+        return std::make_shared<AssignTag>(context, tagName, reader);
+    };
+    tagLoaders_["break"] = [](const Context& context, const StringRef& tagName, BinaryReader& reader) {
+        return std::make_shared<BreakTag>(context, tagName, reader);
+    };
+    tagLoaders_["continue"] = [](const Context& context, const StringRef& tagName, BinaryReader& reader) {
+        return std::make_shared<ContinueTag>(context, tagName, reader);
+    };
+    tagLoaders_["cycle"] = [](const Context& context, const StringRef& tagName, BinaryReader& reader) {
+        return std::make_shared<CycleTag>(context, tagName, reader);
+    };
+    tagLoaders_["decrement"] = [](const Context& context, const StringRef& tagName, BinaryReader& reader) {
+        return std::make_shared<DecrementTag>(context, tagName, reader);
+    };
+    tagLoaders_["increment"] = [](const Context& context, const StringRef& tagName, BinaryReader& reader) {
+        return std::make_shared<IncrementTag>(context, tagName, reader);
+    };
+}
+
+Liquid::Template::Template(const Template& other)
+    : root_(other.root_)
+    , program_(other.program_)
+    , compiled_(other.compiled_)
+    , source_(other.source_)
+    , mapping_(other.mapping_)
+    , staticSize_(other.staticSize_)
+    , optimizationStats_(other.optimizationStats_)
+    , spans_(other.spans_)
+    , averageOutputSize_(other.averageOutputSize_.load())
+    , filters_(other.filters_)
+    , tags_(other.tags_)
+    , tagLoaders_(other.tagLoaders_)
+{
+}
+
+Liquid::Template::Template(Template&& other) noexcept
+    : root_(std::move(other.root_))
+    , program_(std::move(other.program_))
+    , compiled_(other.compiled_)
+    , source_(std::move(other.source_))
+    , mapping_(std::move(other.mapping_))
+    , staticSize_(other.staticSize_)
+    , optimizationStats_(other.optimizationStats_)
+    , spans_(std::move(other.spans_))
+    , averageOutputSize_(other.averageOutputSize_.load())
+    , filters_(std::move(other.filters_))
+    , tags_(std::move(other.tags_))
+    , tagLoaders_(std::move(other.tagLoaders_))
+{
+    other.source_ = emptySource();
+    other.spans_.clear();
+    other.compiled_ = false;
+}
+
+Liquid::Template& Liquid::Template::operator=(const Template& other)
+{
+    if (this != &other) {
+        Template copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+Liquid::Template& Liquid::Template::operator=(Template&& other) noexcept
+{
+    if (this != &other) {
+        root_ = std::move(other.root_);
+        program_ = std::move(other.program_);
+        compiled_ = other.compiled_;
+        source_ = std::move(other.source_);
+        mapping_ = std::move(other.mapping_);
+        staticSize_ = other.staticSize_;
+        optimizationStats_ = other.optimizationStats_;
+        spans_ = std::move(other.spans_);
+        averageOutputSize_ = other.averageOutputSize_.load();
+        filters_ = std::move(other.filters_);
+        tags_ = std::move(other.tags_);
+        tagLoaders_ = std::move(other.tagLoaders_);
+        other.source_ = emptySource();
+        other.spans_.clear();
+        other.compiled_ = false;
+    }
+    return *this;
 }
 
 Liquid::Template& Liquid::Template::parse(const String& source)
 {
+    source_ = std::make_shared<String>(source);
+    mapping_.reset();
+    parseSource();
+    return *this;
+}
+
+Liquid::Template& Liquid::Template::parse(String&& source)
+{
+    source_ = std::make_shared<String>(std::move(source));
+    mapping_.reset();
+    parseSource();
+    return *this;
+}
+
+Liquid::Template& Liquid::Template::parseFile(const std::string& path)
+{
+#if defined(LIQUID_STRING_USE_STD)
+    // The file is already UTF-8, like the source, so parse the mapping
+    // itself and keep it instead of a copy.
+    auto file = std::make_shared<const MappedFile>(path);
+    source_ = emptySource();
+    mapping_ = std::move(file);
+#else
+    auto source = std::make_shared<String>();
+    {
+        const MappedFile file(path);
+        *source = String::fromUtf8(file.data(), file.size());
+    }
     source_ = source;
-    Tokenizer tokenizer(source_);
+    mapping_.reset();
+#endif
+    parseSource();
+    return *this;
+}
+
+Liquid::StringRef Liquid::Template::source() const
+{
+    if (mapping_) {
+        return StringRef(mapping_->data(), mapping_->size());
+    }
+    return StringRef(source_.get());
+}
+
+void Liquid::Template::parseSource()
+{
+    program_ = Program();
+    compiled_ = false;
+    spans_.clear();
+    Tokenizer tokenizer(source());
     Data data(Data::Type::Hash);
     Context ctx(data, filters_, tags_);
-    root_.parse(ctx, tokenizer);
+    std::vector<SourceSpan> spans;
+    root_.parse(ctx, tokenizer, BlockBody::defaultUnknownTagHandler, &spans);
+    optimizationStats_.nodesBefore = root_.nodeCount();
+    root_.optimize(ctx, &spans);
+    optimizationStats_.nodesAfter = root_.nodeCount();
+    staticSize_ = tokenizer.textSize();
+    spans_.swap(spans);
+    averageOutputSize_ = 0;
+}
+
+Liquid::Template& Liquid::Template::edit(String::size_type position, String::size_type removedLength, const String& insertedText)
+{
+    const String::size_type size = source().size();
+    if (position > size || removedLength > size - position) {
+        throw std::out_of_range("Edit is outside the template source");
+    }
+    // The source and nodes of a copy must not change, and a mapped file
+    // can't.
+    if (spans_.empty() || source_.use_count() > 1 || mapping_) {
+        String source = this->source().toString();
+        source.replace(position, removedLength, insertedText);
+        return parse(std::move(source));
+    }
+    String& source = *source_;
+    
+    const auto& nodes = root_.nodes();
+    const auto isText = [&nodes](size_t i) {
+        return std::dynamic_pointer_cast<TextNode>(nodes[i]) != nullptr;
+    };
+    
+    // Start at the first node that may be affected, or at the text before
+    // it, which a full parse would merge with what the edit produces.
+    size_t first = static_cast<size_t>(std::lower_bound(spans_.begin(), spans_.end(), position, [](const SourceSpan& span, String::size_type pos) {
+        return span.end < pos;
+    }) - spans_.begin());
+    if (first > 0 && isText(first - 1)) {
+        --first;
+    }
+    const String::size_type start = first > 0 ? spans_[first - 1].end : 0;
+    const String::size_type editEnd = position + insertedText.size();
+    const std::ptrdiff_t delta = static_cast<std::ptrdiff_t>(insertedText.size()) - static_cast<std::ptrdiff_t>(removedLength);
+    
+    const String removedText = source.mid(position, removedLength);
+    source.replace(position, removedLength, insertedText);
+    
+    BlockBody region;
+    std::vector<SourceSpan> regionSpans;
+    size_t last = spans_.size();
+    String::size_type regionTextSize = 0;
+    try {
+        Tokenizer tokenizer(source, start);
+        Data data(Data::Type::Hash);
+        Context ctx(data, filters_, tags_);
+        size_t next = first;
+        while (region.parseNext(ctx, tokenizer, BlockBody::defaultUnknownTagHandler, &regionSpans)) {
+            // The rest parses as before once a node ends past the edit
+            // where an old one did. Static text would merge with the next
+            // node, so only stop after a node that is not.
+            const String::size_type end = tokenizer.position();
+            if (end < editEnd) {
+                continue;
+            }
+            const String::size_type oldEnd = end - insertedText.size() + removedLength;
+            while (next < spans_.size() && spans_[next].end < oldEnd) {
+                ++next;
+            }
+            String text;
+            if (next < spans_.size() && spans_[next].end == oldEnd && !region.nodes().back()->appendStaticText(ctx, text)) {
+                last = next + 1;
+                break;
+            }
+        }
+        region.optimize(ctx, &regionSpans);
+        regionTextSize = tokenizer.textSize();
+    } catch (...) {
+        source.replace(position, insertedText.size(), removedText);
+        throw;
+    }
+    if (regionSpans.empty()) {
+        String edited = source;
+        return parse(std::move(edited));
+    }
+    
+    size_t parsedNodes = 0;
+    String::size_type textSize = 0;
+    for (size_t i = first; i < last; ++i) {
+        parsedNodes += spans_[i].parsedNodes;
+        textSize += spans_[i].textSize;
+    }
+    optimizationStats_.nodesBefore = optimizationStats_.nodesBefore - parsedNodes;
+    optimizationStats_.nodesAfter = optimizationStats_.nodesAfter - root_.nodeCount(first, last) + region.nodeCount();
+    for (const auto& span : regionSpans) {
+        optimizationStats_.nodesBefore += span.parsedNodes;
+    }
+    staticSize_ = staticSize_ - textSize + regionTextSize;
+    
+    for (size_t i = last; i < spans_.size(); ++i) {
+        nodes[i]->shiftSource(&source, delta);
+        spans_[i].end = static_cast<String::size_type>(static_cast<std::ptrdiff_t>(spans_[i].end) + delta);
+    }
+    root_.replaceNodes(first, last, region);
+    spans_.erase(spans_.begin() + static_cast<std::ptrdiff_t>(first), spans_.begin() + static_cast<std::ptrdiff_t>(last));
+    spans_.insert(spans_.begin() + static_cast<std::ptrdiff_t>(first), regionSpans.begin(), regionSpans.end());
+    program_ = Program();
+    compiled_ = false;
+    averageOutputSize_ = 0;
     return *this;
 }
 
-Liquid::String Liquid::Template::render()
+Liquid::Template& Liquid::Template::compile()
+{
+    program_ = Program();
+    Compiler compiler(program_);
+    compiler.compile(root_);
+    compiled_ = true;
+    return *this;
+}
+
+Liquid::String Liquid::Template::render() const
 {
     Data data(Data::Type::Hash);
     return render(data);
 }
 
-Liquid::String Liquid::Template::render(Data& data)
+Liquid::String Liquid::Template::render(const Data& data) const
+{
+    String output;
+    StringOutputSink out(output);
+    render(data, out);
+    return output;
+}
+
+namespace {
+    class SizeRecordingSink : public Liquid::OutputSink {
+    public:
+        explicit SizeRecordingSink(Liquid::OutputSink& out)
+            : out_(out)
+            , size_(0)
+        {
+        }
+        
+        virtual void append(const Liquid::String& text) override {
+            size_ += text.size();
+            out_.append(text);
+        }
+        
+        virtual void append(const Liquid::StringRef& text) override {
+            size_ += text.size();
+            out_.append(text);
+        }
+        
+        virtual void append(const Liquid::String::value_type* text, Liquid::String::size_type size) override {
+            size_ += size;
+            out_.append(text, size);
+        }
+        
+        virtual void appendStatic(const Liquid::StringRef& text) override {
+            size_ += text.size();
+            out_.appendStatic(text);
+        }
+        
+        virtual void reserve(Liquid::String::size_type size) override {
+            out_.reserve(size);
+        }
+        
+        Liquid::String::size_type size() const {
+            return size_;
+        }
+        
+    private:
+        Liquid::OutputSink& out_;
+        Liquid::String::size_type size_;
+    };
+}
+
+void Liquid::Template::render(const Data& data, OutputSink& out) const
 {
+    SizeRecordingSink sink(out);
+    sink.reserve(estimatedOutputSize());
     Context ctx(data, filters_, tags_);
-    return root_.render(ctx);
+    if (compiled_) {
+        program_.run(ctx, sink);
+    } else {
+        root_.render(ctx, sink);
+    }
+    // Exponential moving average, so the estimate follows the data the
+    // template is currently being rendered with. Concurrent renders may race
+    // on the update, but any of their results is an equally good estimate.
+    const auto size = sink.size();
+    const auto average = averageOutputSize_.load(std::memory_order_relaxed);
+    averageOutputSize_.store(average == 0 ? size : (average * 3 + size) / 4, std::memory_order_relaxed);
+}
+
+Liquid::String::size_type Liquid::Template::estimatedOutputSize() const
+{
+    const auto average = averageOutputSize_.load(std::memory_order_relaxed);
+    if (average == 0) {
+        return staticSize_;
+    }
+    // Leave some headroom so renders slightly above average don't reallocate.
+    return average + average / 8;
+}
+
+Liquid::Renderer Liquid::Template::renderer(const Data& data, String::size_type bufferSize) const
+{
+    return Renderer(*this, data, bufferSize);
+}
+
+std::vector<Liquid::RenderResult> Liquid::Template::renderBatch(const std::vector<Data>& data, Executor& executor) const
+{
+    std::vector<RenderResult> results(data.size());
+    if (data.empty()) {
+        return results;
+    }
+    // Hand out several items per task so queueing overhead stays small, but
+    // enough tasks that idle workers have something to steal.
+    const size_t taskCount = std::min(data.size(), std::max<size_t>(executor.concurrency(), 1) * 8);
+    const size_t itemsPerTask = (data.size() + taskCount - 1) / taskCount;
+    TaskLatch latch((data.size() + itemsPerTask - 1) / itemsPerTask);
+    for (size_t begin = 0; begin < data.size(); begin += itemsPerTask) {
+        const size_t end = std::min(begin + itemsPerTask, data.size());
+        executor.execute([this, &data, &results, &latch, begin, end] {
+            for (size_t i = begin; i < end; ++i) {
+                RenderResult& result = results[i];
+                try {
+                    result.output = render(data[i]);
+                } catch (const std::exception& e) {
+                    result.exception = std::current_exception();
+                    result.error = e.what();
+                } catch (...) {
+                    result.exception = std::current_exception();
+                    result.error = "Unknown error";
+                }
+            }
+            latch.countDown();
+        });
+    }
+    latch.wait(executor);
+    return results;
+}
+
+namespace {
+    // Fixed-size header in front of the serialized template: magic, format
+    // version, character size, source hash and source length. The source
+    // characters follow, then the node tree.
+    const char kSerializedMagic[4] = {'L', 'Q', 'T', 'B'};
+    const uint32_t kSerializedVersion = 2;
+    const size_t kSerializedHeaderSize = 4 + 4 + 4 + 8 + 8;
+    
+    struct SerializedHeader {
+        uint32_t version;
+        uint32_t charSize;
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+    };
+    
+    bool readSerializedHeader(const char* data, size_t size, SerializedHeader& header)
+    {
+        if (size < kSerializedHeaderSize || memcmp(data, kSerializedMagic, sizeof(kSerializedMagic)) != 0) {
+            return false;
+        }
+        memcpy(&header.version, data + 4, 4);
+        memcpy(&header.charSize, data + 8, 4);
+        memcpy(&header.sourceHash, data + 12, 8);
+        memcpy(&header.sourceSize, data + 20, 8);
+        return true;
+    }
+    
+    bool isCurrentFormat(const SerializedHeader& header)
+    {
+        return header.version == kSerializedVersion && header.charSize == sizeof(Liquid::String::value_type);
+    }
+}
+
+std::string Liquid::Template::serialize() const
+{
+    const StringRef source = this->source();
+    BinaryWriter writer(source);
+    writer.writeSize(staticSize_);
+    root_.serialize(writer);
+    
+    const SerializedHeader header{kSerializedVersion, sizeof(String::value_type), hash64(source), source.size()};
+    std::string result(kSerializedMagic, sizeof(kSerializedMagic));
+    result.append(reinterpret_cast<const char*>(&header.version), 4);
+    result.append(reinterpret_cast<const char*>(&header.charSize), 4);
+    result.append(reinterpret_cast<const char*>(&header.sourceHash), 8);
+    result.append(reinterpret_cast<const char*>(&header.sourceSize), 8);
+    result.append(reinterpret_cast<const char*>(source.data()), source.size() * sizeof(String::value_type));
+    result += writer.bytes();
+    return result;
+}
+
+Liquid::Template& Liquid::Template::deserialize(const char* data, size_t size)
+{
+    program_ = Program();
+    compiled_ = false;
+    spans_.clear();
+    SerializedHeader header;
+    if (!readSerializedHeader(data, size, header)) {
+        throw serialization_error("Not a serialized template");
+    }
+    if (!isCurrentFormat(header)) {
+        throw serialization_error("Serialized template has an unsupported format version");
+    }
+    const size_t available = (size - kSerializedHeaderSize) / sizeof(String::value_type);
+    if (header.sourceSize > available) {
+        throw serialization_error("Unexpected end of serialized template");
+    }
+    const auto sourceSize = static_cast<String::size_type>(header.sourceSize);
+    const char* sourceData = data + kSerializedHeaderSize;
+    auto source = std::make_shared<String>();
+    if (sourceSize > 0) {
+        std::vector<String::value_type> chars(sourceSize);
+        memcpy(chars.data(), sourceData, sourceSize * sizeof(String::value_type));
+        *source = String(chars.data(), sourceSize);
+    }
+    if (hash64(*source) != header.sourceHash) {
+        throw serialization_error("Serialized template is corrupt");
+    }
+    
+    root_ = BlockBody();
+    source_ = source;
+    mapping_.reset();
+    const char* treeData = sourceData + sourceSize * sizeof(String::value_type);
+    BinaryReader reader(treeData, static_cast<size_t>(data + size - treeData), *source_, tagLoaders_);
+    Data scratch(Data::Type::Hash);
+    Context ctx(scratch, filters_, tags_);
+    staticSize_ = static_cast<String::size_type>(reader.readSize());
+    root_.load(ctx, reader);
+    if (!reader.atEnd()) {
+        throw serialization_error("Serialized template is corrupt");
+    }
+    optimizationStats_.nodesBefore = optimizationStats_.nodesAfter = root_.nodeCount();
+    averageOutputSize_ = 0;
+    return *this;
+}
+
+void Liquid::Template::saveFile(const std::string& path) const
+{
+    const std::string bytes = serialize();
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+
+Liquid::Template& Liquid::Template::loadFile(const std::string& path)
+{
+    const MappedFile file(path);
+    return deserialize(file.data(), file.size());
+}
+
+bool Liquid::Template::isSerializedFrom(const std::string& path, const String& source)
+{
+    try {
+        const MappedFile file(path);
+        SerializedHeader header;
+        if (!readSerializedHeader(file.data(), file.size(), header) || !isCurrentFormat(header)) {
+            return false;
+        }
+        if (header.sourceSize != source.size() || header.sourceHash != hash64(source)) {
+            return false;
+        }
+        const size_t sourceBytes = source.size() * sizeof(String::value_type);
+        return file.size() - kSerializedHeaderSize >= sourceBytes
+            && memcmp(file.data() + kSerializedHeaderSize, source.data(), sourceBytes) == 0;
+    } catch (const std::runtime_error&) {
+        return false;
+    }
 }
 
-void Liquid::Template::registerFilter(const String& name, const FilterHandler& filter)
+void Liquid::Template::registerFilter(const String& name, const FilterHandler& filter, bool pure)
 {
-    filters_[name] = filter;
+    filters_[name] = FilterDefinition{filter, pure};
 }
 
 
 #ifdef TESTS
 
 #include "tests.hpp"
+#include <cstdio>
+#include <sstream>
+#include <thread>
 
 namespace Liquid {
     class MyDrop : public Drop {
@@ -292,6 +820,477 @@ TEST_CASE("Liquid::Template") {
         CHECK(t.parse("{% raw %} Foobar {{ invalid {% endraw %}{{ 1 }}").render().toStdString() == " Foobar {{ invalid 1");
     }
     
+    SECTION("OutputSink") {
+        Liquid::Template t;
+        t.parse("{% for i in (1..3) %}{% if i > 1 %}, {% endif %}{{ i }}{% endfor %}!");
+        Liquid::Data data(Liquid::Data::Type::Hash);
+        std::ostringstream stream;
+        Liquid::StreamOutputSink sink(stream);
+        t.render(data, sink);
+        CHECK(stream.str() == "1, 2, 3!");
+    }
+    
+    SECTION("EstimatedOutputSize") {
+        Liquid::Template t;
+        CHECK(t.estimatedOutputSize() == 0);
+        t.parse("Hello {{ name }}!{% raw %}{{ raw }}{% endraw %}");
+        CHECK(t.staticSize() == 16);
+        CHECK(t.estimatedOutputSize() == 16);
+        Liquid::Data::Hash hash;
+        hash["name"] = "a considerably longer name than the template";
+        Liquid::Data data(hash);
+        const Liquid::String output = t.render(data);
+        CHECK(t.estimatedOutputSize() >= output.size());
+        t.parse("Hi");
+        CHECK(t.estimatedOutputSize() == 2);
+    }
+    
+    SECTION("ConcurrentRender") {
+        Liquid::Template t;
+        t.parse(
+            "{% assign greeting = name | prepend: 'Hello ' | append: '!' %}{{ greeting }} "
+            "{% for item in items %}{% cycle 'a', 'b' %}{{ item | times: 2 }}/{{ items.size }}"
+            "{% capture last %}{{ item }}{% endcapture %}{% if forloop.last %}.{% else %},{% endif %}{% endfor %} "
+            "{{ last }} {{ name | upcase | size }}"
+        );
+        const auto makeData = [](int i) {
+            Liquid::Data data(Liquid::Data::Type::Hash);
+            data.insert("name", Liquid::String(std::to_string(i)));
+            Liquid::Data items(Liquid::Data::Type::Array);
+            for (int j = 0; j <= i % 7; ++j) {
+                items.push_back(j);
+            }
+            data.insert("items", items);
+            return data;
+        };
+        const int kThreads = 8;
+        const int kRenders = 200;
+        std::vector<Liquid::String> expected;
+        for (int i = 0; i < kRenders; ++i) {
+            Liquid::Data data = makeData(i);
+            expected.push_back(t.render(data));
+        }
+        std::vector<int> mismatches(kThreads, 0);
+        std::vector<std::thread> threads;
+        for (int thread = 0; thread < kThreads; ++thread) {
+            threads.emplace_back([&t, &makeData, &expected, &mismatches, thread] {
+                for (int i = 0; i < kRenders; ++i) {
+                    const int index = (i + thread * 13) % kRenders;
+                    Liquid::Data data = makeData(index);
+                    if (t.render(data) != expected[index]) {
+                        ++mismatches[thread];
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (int thread = 0; thread < kThreads; ++thread) {
+            CHECK(mismatches[thread] == 0);
+        }
+        
+        // One set of data with drops, which load and keep their values as
+        // the renders look them up.
+        Liquid::Template products;
+        products.parse("{% for p in products %}{{ p.name }}:{{ p.price }},{% endfor %}");
+        Liquid::Data list(Liquid::Data::Type::Array);
+        for (int i = 0; i < 200; ++i) {
+            const std::shared_ptr<Liquid::Drop> drop = std::make_shared<Liquid::DropHandler>([i](const Liquid::String& key) -> Liquid::Data {
+                return key == "name" ? Liquid::Data(Liquid::String("p" + std::to_string(i))) : Liquid::Data(i * 10);
+            });
+            list.push_back(drop);
+        }
+        const Liquid::Data shared(Liquid::Data::Hash{{"products", list}});
+        Liquid::String expectedProducts;
+        for (int i = 0; i < 200; ++i) {
+            expectedProducts += Liquid::String("p" + std::to_string(i) + ":" + std::to_string(i * 10) + ",");
+        }
+        std::vector<int> dropMismatches(kThreads, 0);
+        threads.clear();
+        for (int thread = 0; thread < kThreads; ++thread) {
+            threads.emplace_back([&products, &shared, &expectedProducts, &dropMismatches, thread] {
+                for (int i = 0; i < 20; ++i) {
+                    if (products.render(shared) != expectedProducts) {
+                        ++dropMismatches[thread];
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (int thread = 0; thread < kThreads; ++thread) {
+            CHECK(dropMismatches[thread] == 0);
+        }
+    }
+    
+    SECTION("Serialize") {
+        const std::vector<Liquid::String> sources = {
+            "",
+            "Hello {{ name | upcase | append: '!' }} {{ items[1] }} {{ items.size }} {{ user['name'] }} {{ -3 }} {{ 2.5 }} {{ nil }} {{ true }}",
+            "{% assign x = items | first %}{% capture c %}[{{ x }}]{% endcapture %}{{ c }}{% comment %}{{ hidden }}{% endcomment %}",
+            "{% if name == 'Steve' and items.size > 2 or false %}yes{% elsif name contains 'e' %}maybe{% else %}no{% endif %}"
+            "{% unless name %}none{% endunless %}",
+            "{% case name %}{% when 'Bob', 'Steve' %}known{% when 1 or 2 %}number{% else %}unknown{% endcase %}",
+            "{% for i in (1..5) reversed limit: 3 offset: 1 %}{% if i == 2 %}{% continue %}{% endif %}{{ i }}{% if forloop.last %}{% break %}{% endif %}{% endfor %}"
+            "{% for item in items %}{{ item }}{% else %}empty{% endfor %}{% for item in missing %}{% else %}empty{% endfor %}",
+            "{% cycle 'a', 'b' %}{% cycle 'a', 'b' %}{% cycle name: 1, 2 %}{% increment n %}{% increment n %}{% decrement m %}"
+            "{% for i in (1..3) %}{% ifchanged %}{{ name }}{% endifchanged %}{% endfor %}",
+        };
+        Liquid::Data data(Liquid::Data::Type::Hash);
+        data.insert("name", "Steve");
+        data.insert("items", Liquid::Data::Array{1, 2, 3});
+        data.insert("user", Liquid::Data::Hash{{"name", "Bob"}});
+        for (const auto& source : sources) {
+            Liquid::Template parsed;
+            parsed.parse(source);
+            const std::string bytes = parsed.serialize();
+            Liquid::Template loaded;
+            loaded.deserialize(bytes.data(), bytes.size());
+            Liquid::Data data1 = data;
+            Liquid::Data data2 = data;
+            CHECK(loaded.render(data2) == parsed.render(data1));
+            CHECK(loaded.source() == source);
+            CHECK(loaded.staticSize() == parsed.staticSize());
+            CHECK(loaded.serialize() == bytes);
+        }
+        
+        Liquid::Template t;
+        t.parse("{{ a }}{% if a %}b{% endif %}");
+        std::string bytes = t.serialize();
+        Liquid::Template loaded;
+        CHECK_THROWS_AS(loaded.deserialize(bytes.data(), 10), Liquid::serialization_error);
+        CHECK_THROWS_AS(loaded.deserialize(bytes.data(), bytes.size() - 1), Liquid::serialization_error);
+        std::string corrupt = bytes;
+        corrupt[0] = 'X';
+        CHECK_THROWS_AS(loaded.deserialize(corrupt.data(), corrupt.size()), Liquid::serialization_error);
+        corrupt = bytes;
+        corrupt[4] = 99;
+        CHECK_THROWS_AS(loaded.deserialize(corrupt.data(), corrupt.size()), Liquid::serialization_error);
+        corrupt = bytes;
+        corrupt[28] = 'X';
+        CHECK_THROWS_AS(loaded.deserialize(corrupt.data(), corrupt.size()), Liquid::serialization_error);
+    }
+    
+    SECTION("SerializeFile") {
+        const std::string path = "cppliquid-serialize-test.bin";
+        const Liquid::String source = "{% for i in (1..3) %}{{ i | plus: x }}{% endfor %}";
+        Liquid::Template t;
+        t.parse(source);
+        t.saveFile(path);
+        CHECK(Liquid::Template::isSerializedFrom(path, source));
+        CHECK_FALSE(Liquid::Template::isSerializedFrom(path, source + " "));
+        CHECK_FALSE(Liquid::Template::isSerializedFrom(path + ".missing", source));
+        Liquid::Template loaded;
+        loaded.loadFile(path);
+        Liquid::Data data(Liquid::Data::Type::Hash);
+        data.insert("x", 10);
+        CHECK(loaded.render(data) == "111213");
+        std::remove(path.c_str());
+        CHECK_THROWS(loaded.loadFile(path));
+    }
+    
+    SECTION("ParseFile") {
+        const std::string path = "cppliquid-parse-test.liquid";
+        // Large enough to be mapped rather than read.
+        std::string contents;
+        while (contents.size() < 2 * Liquid::MappedFile::kMinMappedSize) {
+            contents += "{% if x %}<{{ x }}>{% endif %}\n";
+        }
+        {
+            std::ofstream out(path.c_str(), std::ios::binary);
+            out << contents;
+        }
+        Liquid::Template t;
+        t.parseFile(path);
+        std::remove(path.c_str());
+        CHECK(t.source().size() == contents.size());
+        Liquid::Template expected;
+        expected.parse(Liquid::String::fromUtf8(contents.data(), contents.size()));
+        const Liquid::Data data(Liquid::Data::Hash{{"x", 1}});
+        const Liquid::String output = expected.render(data);
+        CHECK(t.render(data) == output);
+        CHECK_THROWS_AS(t.parseFile(path), std::runtime_error);
+        CHECK(t.render(data) == output);
+#if defined(LIQUID_STRING_USE_STD)
+        // The nodes refer into the mapping, not into a copy of it.
+        CHECK(t.source().string() == nullptr);
+#endif
+        
+        // Copies keep the mapping after the original is gone.
+        Liquid::Template copy = t;
+        t = Liquid::Template();
+        CHECK(copy.render(data) == output);
+        const std::string serialized = copy.serialize();
+        Liquid::Template loaded;
+        loaded.deserialize(serialized.data(), serialized.size());
+        CHECK(loaded.source() == expected.source().toString());
+        CHECK(loaded.render(data) == output);
+        copy.edit(0, 0, "[");
+        CHECK(copy.source().size() == contents.size() + 1);
+        CHECK(copy.render(data) == Liquid::String("[") + output);
+    }
+    
+    SECTION("ParseFileSizes") {
+        // Smaller files are read, larger ones mapped. Replacing the file,
+        // rather than changing it in place, leaves either template as it
+        // was parsed.
+        const std::string path = "cppliquid-parse-sizes.liquid";
+        const std::string replacement = path + ".new";
+        const auto write = [](const std::string& file, const std::string& contents) {
+            std::ofstream out(file.c_str(), std::ios::binary | std::ios::trunc);
+            out << contents;
+        };
+        const Liquid::Data data(Liquid::Data::Hash{{"x", 1}});
+        for (const size_t size : {Liquid::MappedFile::kMinMappedSize - 1, Liquid::MappedFile::kMinMappedSize}) {
+            std::string contents = "{{ x }}";
+            contents.resize(size, '.');
+            write(path, contents);
+            Liquid::Template t;
+            t.parseFile(path);
+#ifndef _WIN32
+            CHECK(Liquid::MappedFile(path).isMapped() == (size >= Liquid::MappedFile::kMinMappedSize));
+#endif
+            write(replacement, "{{ x }} changed");
+            std::remove(path.c_str());
+            REQUIRE(std::rename(replacement.c_str(), path.c_str()) == 0);
+            CHECK(t.source().size() == size);
+            CHECK(t.render(data) == Liquid::String("1" + std::string(size - 7, '.')));
+        }
+        std::remove(path.c_str());
+    }
+    
+    SECTION("RenderBatch") {
+        Liquid::Template t;
+        t.registerFilter("fail", [](const Liquid::Data& input, const std::vector<Liquid::Data>&) -> Liquid::Data {
+            if (input.toInt() % 10 == 3) {
+                throw std::runtime_error("failed");
+            }
+            return input;
+        });
+        t.parse("{% assign n = i | fail %}<{{ n }}>");
+        std::vector<Liquid::Data> items;
+        for (int i = 0; i < 100; ++i) {
+            Liquid::Data data(Liquid::Data::Type::Hash);
+            data.insert("i", i);
+            items.push_back(data);
+        }
+        Liquid::ThreadPool pool(4);
+        const std::vector<Liquid::RenderResult> results = t.renderBatch(items, pool);
+        REQUIRE(results.size() == items.size());
+        for (int i = 0; i < 100; ++i) {
+            if (i % 10 == 3) {
+                CHECK_FALSE(results[i].succeeded());
+                CHECK(results[i].error == "failed");
+            } else {
+                CHECK(results[i].succeeded());
+                CHECK(results[i].output == Liquid::String("<" + std::to_string(i) + ">"));
+            }
+        }
+        CHECK(t.renderBatch(std::vector<Liquid::Data>(), pool).empty());
+        
+        // From a task on a pool whose only worker is the one running it.
+        Liquid::ThreadPool single(1);
+        std::vector<Liquid::RenderResult> nested;
+        Liquid::TaskLatch latch(1);
+        single.execute([&t, &items, &single, &nested, &latch] {
+            nested = t.renderBatch(items, single);
+            latch.countDown();
+        });
+        latch.wait(single);
+        REQUIRE(nested.size() == items.size());
+        CHECK(nested[1].output == "<1>");
+    }
+    
+    SECTION("RenderDoesNotModifyData") {
+        Liquid::Template t;
+        t.parse("{% assign name = 'x' %}{% capture body %}{{ name }}{% endcapture %}"
+                "{% for item in items %}{{ item }}{{ body }}{% endfor %}{{ name }}");
+        const Liquid::Data data(Liquid::Data::Hash{{"name", "caller"}, {"items", Liquid::Data::Array{1, 2}}});
+        const Liquid::Data before = data;
+        CHECK(t.render(data) == "1x2xx");
+        CHECK(t.render(data) == "1x2xx");
+        CHECK(data == before);
+        CHECK(data["name"].toString() == "caller");
+        CHECK(data["body"].isNil());
+        CHECK(data["item"].isNil());
+    }
+    
+    SECTION("BorrowedStrings") {
+        const auto buffer = std::make_shared<const Liquid::String>("Widgetred,blue");
+        Liquid::Data data(Liquid::Data::Type::Hash);
+        data.insert("title", Liquid::Data(buffer->data(), 6, buffer));
+        data.insert("colors", Liquid::Data(buffer->data() + 6, 8, buffer));
+        data.insert("key", Liquid::Data(buffer->data(), 6, buffer));
+        data.insert("names", Liquid::Data::Hash{{"Widget", "found"}});
+        CHECK_TEMPLATE_DATA_RESULT(
+            "{{ title }} {{ title | upcase }} {{ title | append: '!' }} {{ '<' | append: title }} "
+            "{{ title | size }} {{ title.size }} {% if title == 'Widget' %}same{% endif %} "
+            "{% if colors contains 'blue' %}blue{% endif %} {{ names[key] }} "
+            "{% assign parts = colors | split: ',' %}{% for c in parts %}{{ c }};{% endfor %}{% assign t = title %}{{ t }}",
+            "Widget WIDGET Widget! <Widget 6 6 same blue found red;blue;Widget",
+            data
+        );
+    }
+    
+    SECTION("Optimize") {
+        Liquid::Template t;
+        t.parse("a{% comment %}x{% endcomment %}b{{ v }}c{% if true %}d{% else %}e{% endif %}{% unless true %}f{% endunless %}g");
+        CHECK(t.optimizationStats().nodesBefore == 11);
+        CHECK(t.optimizationStats().nodesAfter == 3);
+        CHECK_DATA_RESULT(t, "abVcdg", (Liquid::Data::Hash{{"v", "V"}}));
+        t.compile();
+        CHECK_DATA_RESULT(t, "abVcdg", (Liquid::Data::Hash{{"v", "V"}}));
+        
+        t.parse("{% for i in (1..3) %}<{% comment %}{% endcomment %}>{% if i > 1 %}{% if 1 == 1 %}[{% endif %}]{% endif %}{% endfor %}");
+        CHECK(t.optimizationStats().nodesBefore == 8);
+        CHECK(t.optimizationStats().nodesAfter == 4);
+        CHECK(t.render() == "<><>[]<>[]");
+        
+        // Dynamic content and side effects are kept.
+        t.parse("{% if x %}a{% endif %}{% if true %}{{ z }}{% endif %}{% if true %}{% assign y = 2 %}{% endif %}{{ y }}");
+        CHECK(t.optimizationStats().nodesBefore == t.optimizationStats().nodesAfter);
+        CHECK_DATA_RESULT(t, "a12", (Liquid::Data::Hash{{"x", true}, {"z", 1}}));
+        
+        // A lone text node is left as it is.
+        t.parse("text");
+        CHECK(t.optimizationStats().nodesBefore == 1);
+        CHECK(t.optimizationStats().nodesAfter == 1);
+        
+        Liquid::Template loaded;
+        t.parse("a{% comment %}x{% endcomment %}b{{ v }}");
+        const std::string bytes = t.serialize();
+        loaded.deserialize(bytes.data(), bytes.size());
+        CHECK(loaded.optimizationStats().nodesAfter == 2);
+        CHECK_DATA_RESULT(loaded, "abV", (Liquid::Data::Hash{{"v", "V"}}));
+    }
+    
+    SECTION("Edit") {
+        Liquid::Template t;
+        t.parse("Hello {{ name }}! {% if a %}A{% endif %} {{ b | upcase }}");
+        t.edit(6, 0, "dear ");
+        CHECK(t.source() == "Hello dear {{ name }}! {% if a %}A{% endif %} {{ b | upcase }}");
+        CHECK_DATA_RESULT(t, "Hello dear N! A X", (Liquid::Data::Hash{{"name", "N"}, {"a", true}, {"b", "x"}}));
+        t.edit(t.source().indexOf("A{%"), 1, "{{ b }}");
+        CHECK_DATA_RESULT(t, "Hello dear N! x X", (Liquid::Data::Hash{{"name", "N"}, {"a", true}, {"b", "x"}}));
+        
+        // A failed edit leaves the template as it was.
+        const Liquid::String source = t.source().toString();
+        CHECK_THROWS_AS(t.edit(t.source().indexOf("{% endif"), 0, "{% endfor %}"), Liquid::syntax_error);
+        CHECK(t.source() == source);
+        CHECK_DATA_RESULT(t, "Hello dear N! x X", (Liquid::Data::Hash{{"name", "N"}, {"a", true}, {"b", "x"}}));
+        CHECK_THROWS_AS(t.edit(source.size(), 1, ""), std::out_of_range);
+        
+        // Loaded templates are parsed again as a whole.
+        Liquid::Template loaded;
+        const std::string bytes = t.serialize();
+        loaded.deserialize(bytes.data(), bytes.size());
+        loaded.edit(0, 5, "Bye");
+        CHECK_DATA_RESULT(loaded, "Bye dear N! x X", (Liquid::Data::Hash{{"name", "N"}, {"a", true}, {"b", "x"}}));
+    }
+    
+    SECTION("CopyAndMove") {
+        const Liquid::Data::Hash hash{{"name", "N"}, {"a", true}};
+        std::vector<Liquid::Template> templates;
+        std::vector<Liquid::String> suffixes;
+        for (int i = 0; i < 20; ++i) {
+            suffixes.push_back(i > 0 ? suffixes.back() + "*" : Liquid::String());
+            Liquid::Template t;
+            t.parse(Liquid::String("{% assign x = name %}{% for i in (1..2) %}{{ x | append: '") + suffixes.back() + "' }}{% endfor %}");
+            templates.push_back(std::move(t));
+        }
+        size_t mismatches = 0;
+        for (size_t i = 0; i < templates.size(); ++i) {
+            Liquid::Data data(hash);
+            if (templates[i].render(data) != Liquid::String("N") + suffixes[i] + "N" + suffixes[i]) {
+                ++mismatches;
+            }
+        }
+        CHECK(mismatches == 0);
+        
+        Liquid::Template copy;
+        {
+            Liquid::Template original;
+            original.parse("{% if a %}{{ name }}{% endif %}!");
+            original.compile();
+            copy = original;
+            
+            // Editing either copy leaves the other alone.
+            original.edit(0, 0, "<");
+            CHECK_DATA_RESULT(original, "<N!", hash);
+            CHECK_DATA_RESULT(copy, "N!", hash);
+            copy.edit(copy.source().size(), 0, ">");
+            CHECK_DATA_RESULT(original, "<N!", hash);
+            CHECK_DATA_RESULT(copy, "N!>", hash);
+        }
+        Liquid::Template moved(std::move(copy));
+        CHECK(copy.source().isEmpty());
+        CHECK_DATA_RESULT(moved, "N!>", hash);
+        moved.edit(0, 0, "[");
+        CHECK_DATA_RESULT(moved, "[N!>", hash);
+    }
+    
+    SECTION("EditMatchesParse") {
+        const char* const snippets[] = {
+            "", "x", " ", "{", "}", "%", "{{", "}}", "{%", "%}", "{{ a }}", "{{ 1 }}",
+            "{% if a %}", "{% endif %}", "{% comment %}", "{% endcomment %}",
+            "{% raw %}", "{% endraw %}", "{% for i in (1..2) %}", "{% endfor %}",
+        };
+        const size_t snippetCount = sizeof(snippets) / sizeof(snippets[0]);
+        Liquid::Template t;
+        t.parse(
+            "a{{ a }}b{% comment %}c{% endcomment %}d{% if a %}e{{ a | upcase }}{% else %}f{% endif %}"
+            "{% raw %}{{ g }}{% endraw %}{% for i in (1..3) %}{{ i }}{% assign x = i %}{% endfor %}{{ x }}h"
+        );
+        uint32_t seed = 12345;
+        const auto random = [&seed](uint32_t n) {
+            seed = seed * 1103515245 + 12345;
+            return (seed >> 16) % n;
+        };
+        size_t mismatches = 0;
+        size_t edits = 0;
+        for (int i = 0; i < 3000; ++i) {
+            const auto size = t.source().size();
+            const auto position = random(static_cast<uint32_t>(size + 1));
+            const auto removed = std::min<Liquid::String::size_type>(random(4), size - position);
+            const Liquid::String inserted = snippets[random(snippetCount)];
+            Liquid::String source = t.source().toString();
+            source.replace(position, removed, inserted);
+            Liquid::Template expected;
+            bool valid = true;
+            try {
+                expected.parse(source);
+            } catch (const std::exception&) {
+                valid = false;
+            }
+            const std::string before = t.serialize();
+            try {
+                t.edit(position, removed, inserted);
+                ++edits;
+                Liquid::Data data1(Liquid::Data::Hash{{"a", "v"}});
+                Liquid::Data data2(Liquid::Data::Hash{{"a", "v"}});
+                if (!valid || t.source() != source || t.serialize() != expected.serialize() ||
+                    t.render(data1) != expected.render(data2) ||
+                    t.optimizationStats().nodesBefore != expected.optimizationStats().nodesBefore ||
+                    t.optimizationStats().nodesAfter != expected.optimizationStats().nodesAfter) {
+                    ++mismatches;
+                    t.parse(source);
+                }
+            } catch (const std::exception&) {
+                if (valid || t.serialize() != before) {
+                    ++mismatches;
+                }
+            }
+            // Keep the template from growing or shrinking too far.
+            if (t.source().size() > 400 || t.source().size() < 20) {
+                t.parse("a{{ a }}b{% if a %}e{% endif %}{% raw %}{{ g }}{% endraw %}c");
+            }
+        }
+        CHECK(mismatches == 0);
+        CHECK(edits > 1000);
+    }
+    
     SECTION("Drop") {
         Liquid::Data drop{std::make_shared<Liquid::MyDrop>()};
         Liquid::Data data{Liquid::Data::Type::Hash};
@@ -4,25 +4,165 @@
 #include "blockbody.hpp"
 #include "filter.hpp"
 #include "tag.hpp"
+#include "renderer.hpp"
+#include "executor.hpp"
+#include "program.hpp"
+#include <atomic>
+#include <string>
 
 namespace Liquid {
     
+    class MappedFile;
+    
+    class RenderResult {
+    public:
+        String output;
+        
+        // Set when the render threw, in which case output is empty.
+        std::exception_ptr exception;
+        String error;
+        
+        bool succeeded() const {
+            return !exception;
+        }
+    };
+    
+    class OptimizationStats {
+    public:
+        // Number of nodes in the parsed template, including nested ones,
+        // before and after merging static text.
+        size_t nodesBefore = 0;
+        size_t nodesAfter = 0;
+    };
+    
+    // Copies of a template share its source and parsed nodes, which are
+    // never changed while shared, so copying is cheap and either copy can be
+    // parsed or edited again without affecting the other. Moving keeps all
+    // references into the source valid.
     class Template {
     public:
         Template();
+        Template(const Template& other);
+        Template(Template&& other) noexcept;
+        Template& operator=(const Template& other);
+        Template& operator=(Template&& other) noexcept;
         
         Template& parse(const String& source);
         
-        String render();
-        String render(Data& data);
+        // Takes over source as the template's source instead of copying it.
+        Template& parse(String&& source);
+        
+        // Parses the UTF-8 file at path. With std strings, a file of
+        // MappedFile::kMinMappedSize or more is mapped and the mapping itself
+        // is the template's source: the parsed nodes refer into it and it
+        // lasts as long as the template (and its copies) use it. Smaller
+        // files are read into memory, and Qt strings are UTF-16, so there the
+        // file is decoded into the source and unmapped before parsing.
+        //
+        // A mapped file must therefore not be changed in place while the
+        // template exists: rendering would show the new contents, or crash
+        // with SIGBUS if the file was truncated. Replace it instead, by
+        // writing a new file and renaming it over the old one, which leaves
+        // the mapping as it was. Throws std::runtime_error if the file cannot
+        // be read.
+        Template& parseFile(const std::string& path);
+        
+        // Replaces removedLength characters at position in the source with
+        // insertedText and parses again, the same as parse() on the edited
+        // source would. Only the top-level nodes around the edit are parsed
+        // again; the others are kept. If parsing fails, the template is left
+        // as it was. Throws std::out_of_range if the edit is not within the
+        // source.
+        Template& edit(String::size_type position, String::size_type removedLength, const String& insertedText);
+        
+        // Compiles the parsed template to a Program, which later renders run
+        // instead of walking the node tree. Parsing or loading again drops
+        // the compiled program.
+        Template& compile();
         
-        void registerFilter(const String& name, const FilterHandler& filter);
+        bool isCompiled() const {
+            return compiled_;
+        }
+        
+        const Program& program() const {
+            return program_;
+        }
+        
+        // Rendering modifies neither the template nor the data: assigns and
+        // loop variables live in the render's own scopes. A parsed template
+        // can be rendered from several threads at once, even with shared data.
+        // Drops in shared data are looked up concurrently then, so their
+        // load() must be safe to call from several threads (see Drop).
+        String render() const;
+        String render(const Data& data) const;
+        void render(const Data& data, OutputSink& out) const;
+        Renderer renderer(const Data& data, String::size_type bufferSize = Renderer::kDefaultBufferSize) const;
+        
+        // Renders the template once per element of data, spread across the
+        // executor. Results are in the same order as data, and an error in
+        // one render is reported in its result without affecting the others.
+        // While waiting, the calling thread runs the executor's queued tasks,
+        // so this may also be called from a task on the same executor.
+        std::vector<RenderResult> renderBatch(const std::vector<Data>& data, Executor& executor) const;
+        
+        // The parsed template in a compact binary form that loads much faster
+        // than parsing the source again. It includes the source and a hash
+        // of it, and is stored in native byte order, so it is meant as a
+        // cache for the same library version on the same platform rather
+        // than as an exchange format. Filters are not included and must be
+        // registered again before loading.
+        std::string serialize() const;
+        Template& deserialize(const char* data, size_t size);
+        void saveFile(const std::string& path) const;
+        Template& loadFile(const std::string& path);
+        
+        // Whether the file at path was serialized from exactly this source
+        // with the current format version, i.e. can be loaded instead of
+        // parsing the source.
+        static bool isSerializedFrom(const std::string& path, const String& source);
+        
+        // Filters are looked up when rendering, but calls to pure filters
+        // with literal arguments are evaluated while parsing, so register
+        // those before parsing.
+        void registerFilter(const String& name, const FilterHandler& filter, bool pure = false);
+        
+        // The source, valid until the template is parsed, edited or
+        // loaded again, or destroyed.
+        StringRef source() const;
+        
+        const OptimizationStats& optimizationStats() const {
+            return optimizationStats_;
+        }
+        
+        // Size of the plain text in the template, known after parsing.
+        String::size_type staticSize() const {
+            return staticSize_;
+        }
+        
+        // Expected size of the next render's output, based on previous
+        // renders or on the static text size before the first one. Used to
+        // reserve the output buffer up front.
+        String::size_type estimatedOutputSize() const;
         
     private:
+        void parseSource();
+        
         BlockBody root_;
-        String source_;
+        Program program_;
+        bool compiled_ = false;
+        std::shared_ptr<String> source_;
+        // When set, the source is this mapped file and source_ is empty.
+        std::shared_ptr<const MappedFile> mapping_;
+        String::size_type staticSize_ = 0;
+        OptimizationStats optimizationStats_;
+        
+        // One per top-level node. Empty when the template was not parsed
+        // from its source, e.g. loaded, in which case edits parse it all.
+        std::vector<SourceSpan> spans_;
+        mutable std::atomic<String::size_type> averageOutputSize_;
         FilterList filters_;
         TagHash tags_;
+        TagLoaderHash tagLoaders_;
     };
 
 }
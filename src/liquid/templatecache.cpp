@@ -0,0 +1,210 @@
+#include "templatecache.hpp"
+
+Liquid::TemplateCache::TemplateCache(size_t maxBytes, size_t shardCount)
+    : maxShardBytes_(maxBytes / (shardCount > 0 ? shardCount : 1))
+    , hits_(0)
+    , misses_(0)
+    , evictions_(0)
+{
+    if (shardCount == 0) {
+        shardCount = 1;
+    }
+    for (size_t i = 0; i < shardCount; ++i) {
+        shards_.emplace_back(new Shard);
+    }
+}
+
+std::shared_ptr<const Liquid::Template> Liquid::TemplateCache::get(const String& source)
+{
+    const uint64_t sourceHash = hash64(source);
+    Shard& shard = shardFor(sourceHash);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::shared_ptr<const Template> found = find(shard, sourceHash, source);
+        if (found) {
+            ++hits_;
+            return found;
+        }
+    }
+    ++misses_;
+    
+    // Parse without holding the lock so lookups of other templates in this
+    // shard are not held up. If another thread parsed the same source in the
+    // meantime, its template wins and ours is dropped.
+    std::shared_ptr<Template> tmpl = std::make_shared<Template>();
+    if (configure_) {
+        configure_(*tmpl);
+    }
+    tmpl->parse(source);
+    
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    std::shared_ptr<const Template> found = find(shard, sourceHash, source);
+    if (found) {
+        return found;
+    }
+    const size_t bytes = estimateBytes(source);
+    shard.lru.push_front(Entry{sourceHash, bytes, tmpl});
+    shard.index.emplace(sourceHash, shard.lru.begin());
+    shard.bytes += bytes;
+    
+    // Always keep the new entry, even if it alone is over the limit.
+    while (shard.bytes > maxShardBytes_ && shard.lru.size() > 1) {
+        const Entry& victim = shard.lru.back();
+        auto range = shard.index.equal_range(victim.hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (&*it->second == &victim) {
+                shard.index.erase(it);
+                break;
+            }
+        }
+        shard.bytes -= victim.bytes;
+        shard.lru.pop_back();
+        ++evictions_;
+    }
+    return tmpl;
+}
+
+std::shared_ptr<const Liquid::Template> Liquid::TemplateCache::find(Shard& shard, uint64_t hash, const String& source)
+{
+    auto range = shard.index.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const auto entry = it->second;
+        if (entry->tmpl->source() == source) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+            return entry->tmpl;
+        }
+    }
+    return nullptr;
+}
+
+void Liquid::TemplateCache::clear()
+{
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->index.clear();
+        shard->lru.clear();
+        shard->bytes = 0;
+    }
+}
+
+size_t Liquid::TemplateCache::size() const
+{
+    size_t count = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        count += shard->lru.size();
+    }
+    return count;
+}
+
+size_t Liquid::TemplateCache::bytes() const
+{
+    size_t total = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->bytes;
+    }
+    return total;
+}
+
+size_t Liquid::TemplateCache::estimateBytes(const String& source)
+{
+    // The template keeps a copy of the source, and the node tree is
+    // typically a few times larger than the text it was parsed from.
+    return sizeof(Template) + source.size() * sizeof(String::value_type) * 4;
+}
+
+
+
+#ifdef TESTS
+
+#include "tests.hpp"
+#include "error.hpp"
+#include <numeric>
+#include <thread>
+
+TEST_CASE("Liquid::TemplateCache") {
+    
+    SECTION("Lookup") {
+        Liquid::TemplateCache cache;
+        auto t1 = cache.get("Hello {{ name }}");
+        auto t2 = cache.get("Hello {{ name }}");
+        auto t3 = cache.get("Bye {{ name }}");
+        CHECK(t1 == t2);
+        CHECK(t1 != t3);
+        CHECK(cache.hits() == 1);
+        CHECK(cache.misses() == 2);
+        CHECK(cache.size() == 2);
+        Liquid::Data data(Liquid::Data::Type::Hash);
+        data.insert("name", "Steve");
+        CHECK(t2->render(data) == "Hello Steve");
+        cache.clear();
+        CHECK(cache.size() == 0);
+        CHECK(cache.bytes() == 0);
+        CHECK(cache.get("Hello {{ name }}") != t1);
+    }
+    
+    SECTION("Eviction") {
+        const Liquid::String a = "a{{ x }}";
+        const Liquid::String b = "b{{ x }}";
+        const Liquid::String c = "c{{ x }}";
+        Liquid::TemplateCache probe;
+        probe.get(a);
+        const size_t entryBytes = probe.bytes();
+        
+        // Room for two entries in a single shard.
+        Liquid::TemplateCache cache(entryBytes * 2, 1);
+        cache.get(a);
+        cache.get(b);
+        cache.get(a);
+        cache.get(c);
+        CHECK(cache.evictions() == 1);
+        CHECK(cache.size() == 2);
+        cache.get(a);
+        CHECK(cache.hits() == 2);
+        cache.get(b);
+        CHECK(cache.misses() == 4);
+    }
+    
+    SECTION("Configure") {
+        Liquid::TemplateCache cache;
+        cache.setConfigure([](Liquid::Template& t) {
+            t.registerFilter("shout", [](const Liquid::Data& input, const std::vector<Liquid::Data>&) -> Liquid::Data {
+                return input.toString().toUpper();
+            });
+        });
+        CHECK(cache.get("{{ 'hi' | shout }}")->render() == "HI");
+    }
+    
+    SECTION("ParseError") {
+        Liquid::TemplateCache cache;
+        CHECK_THROWS_AS(cache.get("{% if %}"), Liquid::syntax_error);
+        CHECK(cache.size() == 0);
+    }
+    
+    SECTION("Concurrent") {
+        Liquid::TemplateCache cache(Liquid::TemplateCache::kDefaultMaxBytes, 4);
+        std::vector<int> mismatches(8, 0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; ++t) {
+            threads.emplace_back([&cache, &mismatches, t] {
+                for (int i = 0; i < 200; ++i) {
+                    const std::string n = std::to_string(i % 20);
+                    auto tmpl = cache.get(Liquid::String("{{ " + n + " }}"));
+                    if (tmpl->render() != Liquid::String(n)) {
+                        ++mismatches[t];
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        CHECK(std::accumulate(mismatches.begin(), mismatches.end(), 0) == 0);
+        CHECK(cache.size() == 20);
+        CHECK(cache.hits() + cache.misses() == 1600);
+    }
+    
+}
+
+#endif
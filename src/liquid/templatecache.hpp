@@ -0,0 +1,96 @@
+#ifndef LIQUID_TEMPLATECACHE_HPP
+#define LIQUID_TEMPLATECACHE_HPP
+
+#include "template.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Liquid {
+
+    // Keeps parsed templates around so the same source is only tokenized and
+    // parsed once. Entries are looked up by a 64-bit hash of the source and
+    // confirmed with a full compare. Each shard has its own lock and its own
+    // least-recently-used list, bounded by an approximate byte count.
+    //
+    // Cached templates are shared and immutable; they can be rendered from any
+    // number of threads at once.
+    class TemplateCache {
+    public:
+        using Configure = std::function<void(Template&)>;
+
+        static const size_t kDefaultMaxBytes = 64 * 1024 * 1024;
+        static const size_t kDefaultShardCount = 16;
+
+        explicit TemplateCache(size_t maxBytes = kDefaultMaxBytes, size_t shardCount = kDefaultShardCount);
+
+        TemplateCache(const TemplateCache&) = delete;
+        TemplateCache& operator=(const TemplateCache&) = delete;
+
+        // Called on every new template before it is parsed, e.g. to register
+        // filters. Set it before the first lookup.
+        void setConfigure(const Configure& configure) {
+            configure_ = configure;
+        }
+
+        // Returns the parsed template for source, parsing it on a miss.
+        // Parse errors are thrown and nothing is cached.
+        std::shared_ptr<const Template> get(const String& source);
+
+        void clear();
+
+        size_t hits() const {
+            return hits_;
+        }
+
+        size_t misses() const {
+            return misses_;
+        }
+
+        size_t evictions() const {
+            return evictions_;
+        }
+
+        // Number of cached templates.
+        size_t size() const;
+
+        // Approximate memory used by the cached templates.
+        size_t bytes() const;
+
+    private:
+        struct Entry {
+            uint64_t hash;
+            size_t bytes;
+            std::shared_ptr<const Template> tmpl;
+        };
+
+        struct Shard {
+            mutable std::mutex mutex;
+            std::list<Entry> lru; // Most recently used first.
+            std::unordered_multimap<uint64_t, std::list<Entry>::iterator> index;
+            size_t bytes = 0;
+        };
+
+        std::vector<std::unique_ptr<Shard>> shards_;
+        const size_t maxShardBytes_;
+        Configure configure_;
+        std::atomic<size_t> hits_;
+        std::atomic<size_t> misses_;
+        std::atomic<size_t> evictions_;
+
+        Shard& shardFor(uint64_t hash) {
+            return *shards_[hash % shards_.size()];
+        }
+
+        std::shared_ptr<const Template> find(Shard& shard, uint64_t hash, const String& source);
+        static size_t estimateBytes(const String& source);
+    };
+
+}
+
+#endif
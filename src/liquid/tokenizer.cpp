@@ -2,113 +2,168 @@
 #include "stringscanner.hpp"
 #include "error.hpp"
 
-std::vector<Liquid::Component> Liquid::Tokenizer::tokenize(const String& source) const
+const Liquid::Component* Liquid::Tokenizer::next()
 {
-    std::vector<Component> components;
-    String::size_type lastStartPos = 0;
-    const String::size_type len = source.size();
-    const String::size_type lastCharPos = len - 1;
-    const String endStr[] = {"}}", "%}"};
+    if (hasPending_) {
+        hasPending_ = false;
+        return emit(pending_, pendingEnd_);
+    }
     
-    while (lastStartPos < len) {
+    const String::size_type size = source_.size();
+    while (textStartPos_ < size) {
+        const String::size_type textPos = textStartPos_;
+        
         // Look for the next starting object or tag
-        const String::size_type startPos = source.indexOf('{', lastStartPos);
-        if (startPos == String::npos || startPos == lastCharPos) {
-            break;
+        const String::size_type startPos = delimiters_.nextOpen(textPos);
+        if (startPos == String::npos) {
+            // Process any remaining text
+            textStartPos_ = size;
+            setText(current_, textPos, size - textPos);
+            return emit(current_, size);
         }
         
-        // Check the next character
-        const String::value_type nextChar = source.at(startPos + 1);
-        if (nextChar == '{' || nextChar == '%') {
-            // Look for the end of the object or tag
-            const bool isObject = nextChar == '{';
-            const String::size_type endPos = source.indexOf(endStr[isObject ? 0 : 1], startPos + 2);
-            if (endPos == String::npos) {
-                throw syntax_error("Tag not properly terminated");
-            }
-            
-            // Collect any text component before the object or tag
-            const auto textChunkLen = startPos - lastStartPos;
-            if (textChunkLen > 0) {
-                const StringRef text = source.midRef(lastStartPos, textChunkLen);
-                components.emplace_back(Component::Type::Text, text, text);
-            }
-            
-            // Collect the complete text of the object or tag
-            const auto tagEndPos = endPos + 2;
-            const StringRef tag = source.midRef(startPos, tagEndPos - startPos);
-            const StringRef tagTrimmed = trim(tag.mid(2, tag.size() - 4));
-            
-            lastStartPos = tagEndPos;
-            
-            // Process special tags
-            bool addComponent = true;
-            if (!isObject) {
-                const bool isRaw = tagTrimmed == "raw";
-                if (isRaw) {
-                    const String endTag = String("end") + tagTrimmed.toString();
-                    // Scan for the complete {% endxxx %} tag
-                    const StringRef sourceRef{&source};
-                    StringScanner ss(sourceRef, lastStartPos);
-                    bool foundEnd = false;
-                    StringRef::size_type rawendPos = static_cast<StringRef::size_type>(-1);
-                    const String tagStartStr = "{%";
-                    while (!ss.eof()) {
-                        const auto savePos = ss.position();
-                        if (ss.scanUpTo(tagStartStr)) {
-                            rawendPos = ss.position();
-                            ss.advance(static_cast<int>(tagStartStr.size()));
-                            (void)ss.skipWhitespace();
-                            const StringRef tagIdentifier = ss.scanIdentifier();
-                            if (tagIdentifier == endTag) {
-                                (void)ss.skipWhitespace();
-                                if (ss.scanString(endStr[1])) {
-                                    foundEnd = true;
-                                    break;
-                                }
-                            }
-                        }
-                        ss.setPosition(savePos + 1);
-                    }
-                    if (!foundEnd) {
-                        throw syntax_error(String("%1 tag not properly terminated").arg(tagTrimmed.toString()).toStdString());
-                    }
-                    if (isRaw) {
-                        const auto rawChunkLen = rawendPos - lastStartPos;
-                        if (rawChunkLen > 0) {
-                            const StringRef text = source.midRef(lastStartPos, rawChunkLen);
-                            components.emplace_back(Component::Type::Text, text, text);
-                        }
+        // Look for the end of the object or tag
+        const bool isObject = source_.at(startPos + 1) == '{';
+        const String::size_type endPos = isObject ? delimiters_.nextObjectEnd(startPos + 2) : delimiters_.nextTagEnd(startPos + 2);
+        if (endPos == String::npos) {
+            throw syntax_error("Tag not properly terminated");
+        }
+        
+        // Collect the complete text of the object or tag
+        const auto tagEndPos = endPos + 2;
+        const StringRef tag = source_.mid(startPos, tagEndPos - startPos);
+        const StringRef tagTrimmed = trim(tag.mid(2, tag.size() - 4));
+        
+        textStartPos_ = tagEndPos;
+        
+        // Process special tags
+        if (!isObject && tagTrimmed == "raw") {
+            // Everything up to the first {% endraw %} is text. Each "{%" is
+            // looked at once, so this is linear in the size of the block.
+            String::size_type rawEndPos = String::npos;
+            for (auto pos = delimiters_.nextOpen(tagEndPos); pos != String::npos; pos = delimiters_.nextOpen(pos + 1)) {
+                if (source_.at(pos + 1) != '%') {
+                    continue;
+                }
+                StringScanner ss(source_, pos + 2);
+                (void)ss.skipWhitespace();
+                if (ss.scanIdentifier() == "endraw") {
+                    (void)ss.skipWhitespace();
+                    if (ss.scanString("%}")) {
+                        rawEndPos = pos;
+                        textStartPos_ = ss.position();
+                        break;
                     }
-                    addComponent = false;
-                    lastStartPos = ss.position();
                 }
             }
-            
-            if (addComponent) {
-                components.emplace_back(isObject ? Component::Type::Object : Component::Type::Tag, tag, tagTrimmed);
+            if (rawEndPos == String::npos) {
+                throw syntax_error(String("%1 tag not properly terminated").arg(tagTrimmed.toString()).toStdString());
+            }
+            hasPending_ = rawEndPos > tagEndPos;
+            if (hasPending_) {
+                setText(pending_, tagEndPos, rawEndPos - tagEndPos);
             }
         } else {
-            ++lastStartPos;
+            pending_ = Component(isObject ? Component::Type::Object : Component::Type::Tag, tag, tagTrimmed);
+            hasPending_ = true;
+        }
+        pendingEnd_ = textStartPos_;
+        
+        // Return any text component before the object or tag first
+        if (startPos > textPos) {
+            setText(current_, textPos, startPos - textPos);
+            return emit(current_, startPos);
+        }
+        if (hasPending_) {
+            hasPending_ = false;
+            return emit(pending_, pendingEnd_);
         }
     }
-    
-    // Process any remaining text
-    if (lastStartPos < len) {
-        const StringRef text = source.midRef(lastStartPos);
-        components.emplace_back(Component::Type::Text, text, text);
+    return nullptr;
+}
+
+void Liquid::Tokenizer::setText(Component& comp, String::size_type pos, String::size_type count)
+{
+    const StringRef text = source_.mid(pos, count);
+    comp = Component(Component::Type::Text, text, text);
+}
+
+const Liquid::Component* Liquid::Tokenizer::emit(const Component& comp, String::size_type end)
+{
+    if (comp.type == Component::Type::Text) {
+        textSize_ += comp.text.size();
     }
-    
-    return components;
+    position_ = end;
+    return &comp;
 }
 
 
 #ifdef TESTS
 
 #include "catch.hpp"
+#include <type_traits>
+
+// A temporary source would be gone before the tokenizer reads it.
+static_assert(!std::is_constructible<Liquid::Tokenizer, const char*>::value, "Tokenizer must not take a temporary");
+static_assert(!std::is_constructible<Liquid::Tokenizer, Liquid::String&&>::value, "Tokenizer must not take a temporary");
 
 TEST_CASE("Liquid::Tokenizer") {
     
+    SECTION("Text") {
+        const Liquid::String source = "a{b{{ x }}c{ d}}%}";
+        Liquid::Tokenizer tokenizer(source);
+        const Liquid::Component* comp = tokenizer.next();
+        REQUIRE(comp);
+        CHECK(comp->type == Liquid::Component::Type::Text);
+        CHECK(comp->text == "a{b");
+        comp = tokenizer.next();
+        REQUIRE(comp);
+        CHECK(comp->type == Liquid::Component::Type::Object);
+        CHECK(comp->innerText == "x");
+        CHECK(tokenizer.position() == 10);
+        comp = tokenizer.next();
+        REQUIRE(comp);
+        CHECK(comp->text == "c{ d}}%}");
+        CHECK_FALSE(tokenizer.next());
+        CHECK(tokenizer.textSize() == 11);
+    }
+    
+    SECTION("Position") {
+        const Liquid::String source = "ab{{ x }}cd";
+        Liquid::Tokenizer tokenizer(source, 2);
+        const Liquid::Component* comp = tokenizer.next();
+        REQUIRE(comp);
+        CHECK(comp->type == Liquid::Component::Type::Object);
+        CHECK(tokenizer.position() == 9);
+        CHECK(tokenizer.textSize() == 0);
+        comp = tokenizer.next();
+        REQUIRE(comp);
+        CHECK(comp->text == "cd");
+        CHECK(tokenizer.position() == 11);
+        CHECK(tokenizer.textSize() == 2);
+        CHECK_FALSE(tokenizer.next());
+    }
+    
+    SECTION("Raw") {
+        const Liquid::String source = "{% raw %}{{ a }}{% if %}{%endraw x %}{%  endraw  %}b";
+        Liquid::Tokenizer tokenizer(source);
+        const Liquid::Component* comp = tokenizer.next();
+        REQUIRE(comp);
+        CHECK(comp->text == "{{ a }}{% if %}{%endraw x %}");
+        CHECK(tokenizer.position() == 51);
+        comp = tokenizer.next();
+        REQUIRE(comp);
+        CHECK(comp->text == "b");
+        CHECK_FALSE(tokenizer.next());
+        
+        const Liquid::String unterminated = "a{% raw %}{{ a }}";
+        Liquid::Tokenizer unterminatedTokenizer(unterminated);
+        CHECK_THROWS_AS(unterminatedTokenizer.next(), Liquid::syntax_error);
+        const Liquid::String mismatched = "{% if a }}";
+        Liquid::Tokenizer mismatchedTokenizer(mismatched);
+        CHECK_THROWS_AS(mismatchedTokenizer.next(), Liquid::syntax_error);
+    }
+    
 }
 
 #endif
@@ -2,7 +2,7 @@
 #define LIQUID_TOKENIZER_HPP
 
 #include "string.hpp"
-#include <vector>
+#include "delimiters.hpp"
 
 namespace Liquid {
 
@@ -26,28 +26,66 @@ namespace Liquid {
         StringRef innerText;
     };
     
+    // Splits a source into components on demand, so that parsing is a
+    // single pass over the source without a list of all its components.
     class Tokenizer {
     public:
-        Tokenizer(const String& source)
-            : tokens_(tokenize(source))
-            , pos_(0)
+        // Starts at position, which must be where a component starts, e.g.
+        // where an earlier pass over the source ended a component. The
+        // components refer into source.
+        Tokenizer(const StringRef& source, String::size_type position = 0)
+            : source_(source)
+            , delimiters_(source)
+            , textStartPos_(position)
+            , textSize_(0)
+            , position_(position)
+            , pendingEnd_(position)
+            , current_(Component::Type::Text, StringRef(), StringRef())
+            , pending_(Component::Type::Text, StringRef(), StringRef())
+            , hasPending_(false)
         {
         }
         
-        const Component* next() {
-            if (pos_ >= tokens_.size()) {
-                return nullptr;
-            }
-            const Component *comp = &tokens_.at(pos_);
-            ++pos_;
-            return comp;
+        Tokenizer(const String& source, String::size_type position = 0)
+            : Tokenizer(StringRef(&source), position)
+        {
+        }
+        
+        // The source is referenced, not copied, so it can't be a temporary.
+        Tokenizer(String&& source, String::size_type position = 0) = delete;
+        
+        // Returns the next component, valid until the following call, or
+        // nullptr at the end of the source.
+        const Component* next();
+        
+        // Total size of the plain text components (including raw blocks)
+        // returned so far.
+        String::size_type textSize() const {
+            return textSize_;
+        }
+        
+        // Where the last component returned ends in the source, including
+        // the end tag of a raw block.
+        String::size_type position() const {
+            return position_;
         }
         
     private:
-        const std::vector<Component> tokens_;
-        size_t pos_;
-
-        std::vector<Component> tokenize(const String& source) const;
+        const StringRef source_;
+        const DelimiterScanner delimiters_;
+        String::size_type textStartPos_;
+        String::size_type textSize_;
+        String::size_type position_;
+        String::size_type pendingEnd_;
+        
+        // An object or tag that follows some text is found together with the
+        // text and returned by the following call.
+        Component current_;
+        Component pending_;
+        bool hasPending_;
+        
+        void setText(Component& comp, String::size_type pos, String::size_type count);
+        const Component* emit(const Component& comp, String::size_type end);
     };
 
 }
@@ -1,6 +1,7 @@
 #include "variable.hpp"
 #include "context.hpp"
 #include "error.hpp"
+#include "serializer.hpp"
 
 Liquid::Variable::Variable(const StringRef& input)
 {
@@ -13,6 +14,41 @@ Liquid::Variable::Variable(Parser& parser)
     parse(parser);
 }
 
+Liquid::Variable::Variable(BinaryReader& reader)
+    : exp_(Expression::load(reader))
+{
+    const auto filterCount = reader.readSize();
+    for (uint64_t i = 0; i < filterCount; ++i) {
+        const StringRef name = reader.readStringRef();
+        std::vector<Expression> args;
+        const auto argCount = reader.readSize();
+        for (uint64_t j = 0; j < argCount; ++j) {
+            args.push_back(Expression::load(reader));
+        }
+        filters_.emplace_back(name, args);
+    }
+}
+
+void Liquid::Variable::shiftSource(const String* source, std::ptrdiff_t delta)
+{
+    for (auto& filter : filters_) {
+        filter.shiftSource(source, delta);
+    }
+}
+
+void Liquid::Variable::serialize(BinaryWriter& writer) const
+{
+    exp_.serialize(writer);
+    writer.writeSize(filters_.size());
+    for (const auto& filter : filters_) {
+        writer.writeStringRef(filter.name());
+        writer.writeSize(filter.args().size());
+        for (const auto& arg : filter.args()) {
+            arg.serialize(writer);
+        }
+    }
+}
+
 void Liquid::Variable::parse(Parser& parser)
 {
     exp_ = Expression::parse(parser);
@@ -35,38 +71,116 @@ void Liquid::Variable::parse(Parser& parser)
     }
 }
 
-const Liquid::Data& Liquid::Variable::evaluate(const Context& context) const
+void Liquid::Variable::fold(const Context& context)
 {
-    const Data& result = exp_.evaluate(context.data());
+    if (constant_ || !exp_.isLiteral()) {
+        return;
+    }
+    for (const auto& filter : filters_) {
+        const auto filterIter = context.filters().find(filter.key());
+        if (filterIter == context.filters().end() || !filterIter->second.pure) {
+            return;
+        }
+        for (const auto& arg : filter.args()) {
+            if (!arg.isLiteral()) {
+                return;
+            }
+        }
+    }
+    try {
+        Data scratch(Data::Type::Hash);
+        Context evaluationContext(scratch, context.filters(), context.tags());
+        constant_ = std::make_shared<const Data>(evaluate(evaluationContext));
+    } catch (const std::exception&) {
+    }
+}
+
+const Liquid::Data& Liquid::Variable::evaluate(Context& context) const
+{
+    if (constant_) {
+        return *constant_;
+    }
+    const Data* input = &exp_.evaluate(context);
     if (filters_.empty()) {
-        return result;
+        return *input;
     }
-    Data value = result;
+    // The first filter reads the value where it is; each result is then
+    // moved along instead of copied.
+    Data value;
+    std::vector<Data> evaluatedArgs;
     for (const auto& filter : filters_) {
-        const auto& args = filter.args();
-        std::vector<Data> evaluatedArgs;
-        for (const auto& arg : args) {
-            evaluatedArgs.push_back(arg.evaluate(context.data()));
+        evaluatedArgs.clear();
+        for (const auto& arg : filter.args()) {
+            evaluatedArgs.push_back(arg.evaluate(context));
         }
-        const auto filterIter = context.filters().find(filter.name().toString().toStdString());
+        const auto filterIter = context.filters().find(filter.key());
         if (filterIter == context.filters().end()) {
-            throw syntax_error(String("Unknown filter %1").arg(filter.name().toString()).toStdString());
+            throw syntax_error(String("Unknown filter %1").arg(filter.key()).toStdString());
         }
-        value = filterIter->second(value, evaluatedArgs);
+        value = filterIter->second.handler(*input, evaluatedArgs);
+        input = &value;
     }
-    cached_ = value;
-    return cached_;
+    Data& cached = context.scratch(this);
+    cached = std::move(value);
+    return cached;
 }
 
 
 
 #ifdef TESTS
 
-#include "catch.hpp"
+#include "tests.hpp"
+#include "template.hpp"
 
 TEST_CASE("Liquid::Variable") {
     
-
+    SECTION("Fold") {
+        int pureCalls = 0;
+        int impureCalls = 0;
+        Liquid::Template t;
+        t.registerFilter("pure", [&pureCalls](const Liquid::Data& input, const std::vector<Liquid::Data>&) -> Liquid::Data {
+            ++pureCalls;
+            return input;
+        }, true);
+        t.registerFilter("impure", [&impureCalls](const Liquid::Data& input, const std::vector<Liquid::Data>&) -> Liquid::Data {
+            ++impureCalls;
+            return input;
+        });
+        t.parse("{{ 'a' | pure | upcase }}{{ 'b' | impure }}{% assign x = 1 | pure | plus: 1 %}{{ x }}{{ x | pure }}");
+        CHECK(pureCalls == 2);
+        CHECK(t.render() == "Ab22");
+        CHECK(t.render() == "Ab22");
+        CHECK(pureCalls == 4);
+        CHECK(impureCalls == 2);
+        
+        // Folded text survives serialization and compilation.
+        const std::string bytes = t.serialize();
+        Liquid::Template loaded;
+        loaded.registerFilter("pure", [](const Liquid::Data& input, const std::vector<Liquid::Data>&) -> Liquid::Data {
+            return input;
+        }, true);
+        loaded.registerFilter("impure", [](const Liquid::Data& input, const std::vector<Liquid::Data>&) -> Liquid::Data {
+            return input;
+        });
+        loaded.deserialize(bytes.data(), bytes.size()).compile();
+        CHECK(loaded.render() == "Ab22");
+    }
+    
+    SECTION("FoldLiterals") {
+        CHECK_TEMPLATE_RESULT("{{ 'Hello' | upcase | append: '!' }}", "HELLO!");
+        CHECK_TEMPLATE_RESULT("{% assign tax = 0.2 | times: 100 %}{{ tax }}", "20");
+        CHECK_TEMPLATE_RESULT("{{ 'a,b,c' | split: ',' | reverse | join: '-' }}", "c-b-a");
+        CHECK_TEMPLATE_RESULT("{{ 5 }}{{ true }}{{ nil }}", "5true");
+        CHECK_TEMPLATE_DATA_RESULT("{{ 'x' | append: y }}", "xz", (Liquid::Data::Hash{{"y", "z"}}));
+        
+        // Errors are still reported when rendering.
+        Liquid::Template t;
+        t.parse("{{ 'a' | nosuchfilter }}");
+        CHECK_THROWS_AS(t.render(), Liquid::syntax_error);
+        t.parse("{{ 'a' | truncate: 1, 2, 3 }}");
+        CHECK_THROWS(t.render());
+    }
+    
 }
 
 #endif
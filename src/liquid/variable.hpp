@@ -10,19 +10,39 @@ namespace Liquid {
     
     class Parser;
     class Context;
+    class BinaryWriter;
+    class BinaryReader;
     
     class Variable {
     public:
         Variable() {}
         Variable(const StringRef& input);
         Variable(Parser& parser);
+        explicit Variable(BinaryReader& reader);
         
-        const Data& evaluate(const Context& context) const;
+        const Data& evaluate(Context& context) const;
+        
+        // A literal with only pure filters and literal arguments always has
+        // the same value, so evaluate it once, now. Variables that fail to
+        // evaluate are left alone so the error is reported when rendering.
+        void fold(const Context& context);
+        
+        bool isConstant() const {
+            return constant_ != nullptr;
+        }
+        
+        const Data& constant() const {
+            return *constant_;
+        }
+        
+        void serialize(BinaryWriter& writer) const;
+        
+        void shiftSource(const String* source, std::ptrdiff_t delta);
 
     private:
         Expression exp_;
         std::vector<Filter> filters_;
-        mutable Data cached_;
+        std::shared_ptr<const Data> constant_;
         
         void parse(Parser& parser);
     };
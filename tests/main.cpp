@@ -1,4 +1,5 @@
 #define CATCH_CONFIG_RUNNER
+#define CATCH_CONFIG_NO_POSIX_SIGNALS // SIGSTKSZ is no longer constant in newer glibc
 #include "catch.hpp"
 
 int main(int argc, char* const argv[]) {
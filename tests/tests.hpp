@@ -1,19 +1,26 @@
 #include "catch.hpp"
 
+// Templates are checked with both the tree interpreter and the compiled
+// program, rendering the same data twice since rendering must not modify it.
+
 #define CHECK_TEMPLATE_RESULT(i,o) { \
     Liquid::Template __t; \
     __t.parse(i); \
     CHECK(__t.render() == o); \
+    __t.compile(); \
+    CHECK(__t.render() == o); \
 }
 
 #define CHECK_TEMPLATE_DATA_RESULT(i,o,d) { \
-    Liquid::Data __d{d}; \
     Liquid::Template __t; \
     __t.parse(i); \
+    const Liquid::Data __d{d}; \
+    CHECK(__t.render(__d) == o); \
+    __t.compile(); \
     CHECK(__t.render(__d) == o); \
 }
 
 #define CHECK_DATA_RESULT(t,o,d) { \
-    Liquid::Data __d{d}; \
+    const Liquid::Data __d{d}; \
     CHECK(t.render(__d) == o); \
 }